@@ -0,0 +1,263 @@
+//
+// pav1iet - PASCAL Annotation Version 1.00 Extractor Tool
+// Copyright (C) 2026 Sergiu Deitsch <sergiu.deitsch@gmail.com>
+//
+// This file is part of pav1iet.
+//
+// pav1iet is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pav1iet is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pav1iet.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgcodecs/imgcodecs.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <string>
+#include <vector>
+
+#define BOOST_SPIRIT_X3_UNICODE
+
+#include <benchmark/benchmark.h>
+#include <boost/fusion/adapted/std_tuple.hpp>
+#include <boost/spirit/home/x3.hpp>
+
+#include "crop.hpp"
+#include "dataset.hpp"
+#include "fast_parser.hpp"
+#include "grammar.hpp"
+#include "resample.hpp"
+
+namespace {
+
+const cv::Size WindowSize{64, 128};
+const int Padding = 16;
+
+// Parses an in-memory annotation file with the given number of objects
+void BM_ParseAnnotations(benchmark::State& state)
+{
+    namespace x3 = boost::spirit::x3;
+
+    cv::RNG rng;
+    const cv::Size imageSize{640, 480};
+    const std::string text = pav1iet::makeAnnotation(
+        "images/000000.png", imageSize, pav1iet::randomBoxes(rng, imageSize, static_cast<std::size_t>(state.range(0))));
+
+    for (auto _ : state) {
+        pascal_v1::ast::Annotations annotations;
+        const char* first = text.data();
+
+        const bool parsed = x3::phrase_parse(first, text.data() + text.size(), pascal_v1::annotation >> x3::eoi,
+                                             x3::unicode::space, annotations);
+
+        if (!parsed) {
+            state.SkipWithError("failed to parse the annotations");
+            break;
+        }
+
+        benchmark::DoNotOptimize(annotations);
+    }
+
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * text.size()));
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_ParseAnnotations)->RangeMultiplier(4)->Range(1, 64);
+
+// Parses the same annotations as BM_ParseAnnotations without constructing the
+// AST
+void BM_ParseAnnotationsFast(benchmark::State& state)
+{
+    struct Handler
+    {
+        void objectName(std::string_view name)
+        {
+            benchmark::DoNotOptimize(name);
+        }
+
+        void header(const pascal_v1::fast::HeaderView& header)
+        {
+            benchmark::DoNotOptimize(header);
+        }
+
+        void object(const pascal_v1::fast::ObjectView& object)
+        {
+            benchmark::DoNotOptimize(object);
+        }
+    };
+
+    cv::RNG rng;
+    const cv::Size imageSize{640, 480};
+    const std::string text = pav1iet::makeAnnotation(
+        "images/000000.png", imageSize, pav1iet::randomBoxes(rng, imageSize, static_cast<std::size_t>(state.range(0))));
+
+    for (auto _ : state) {
+        if (!pascal_v1::fast::parse(text, Handler{})) {
+            state.SkipWithError("failed to parse the annotations");
+            break;
+        }
+    }
+
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * text.size()));
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_ParseAnnotationsFast)->RangeMultiplier(4)->Range(1, 64);
+
+// Computes the crop, the affine transformation and the interpolation of each
+// object
+void BM_CropMath(benchmark::State& state)
+{
+    cv::RNG rng;
+    const cv::Size imageSize{1280, 960};
+    const std::vector<cv::Rect> boxes = pav1iet::randomBoxes(rng, imageSize, 1024);
+
+    for (auto _ : state) {
+        for (const cv::Rect& box : boxes) {
+            const pav1iet::Crop crop = pav1iet::planCrop(box, imageSize.height, WindowSize, Padding);
+            benchmark::DoNotOptimize(pav1iet::cropTransform(crop, WindowSize));
+            benchmark::DoNotOptimize(pav1iet::cropInterpolation(crop, WindowSize));
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(boxes.size()));
+}
+
+BENCHMARK(BM_CropMath);
+
+// Arguments are the image height and the bounding box height. Boxes smaller
+// than the window are upsampled, larger ones downsampled.
+template<class Extract>
+void cropObjects(benchmark::State& state, Extract extract)
+{
+    cv::RNG rng;
+    const int height = static_cast<int>(state.range(0));
+    const cv::Size imageSize{height * 4 / 3, height};
+    const cv::Mat image = pav1iet::randomImage(rng, imageSize);
+
+    const int boxHeight = static_cast<int>(state.range(1));
+    const cv::Rect box{(imageSize.width - boxHeight / 2) / 2, (imageSize.height - boxHeight) / 2, boxHeight / 2,
+                       boxHeight};
+    const pav1iet::Crop crop = pav1iet::planCrop(box, imageSize.height, WindowSize, Padding);
+    const cv::Matx23f M = pav1iet::cropTransform(crop, WindowSize);
+    const cv::InterpolationFlags flags = pav1iet::cropInterpolation(crop, WindowSize);
+
+    cv::Mat patch;
+
+    for (auto _ : state) {
+        extract(image, patch, M, flags);
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_WarpAffine(benchmark::State& state)
+{
+    cropObjects(state, [] (const cv::Mat& image, cv::Mat& patch, const cv::Matx23f& M, cv::InterpolationFlags flags) {
+        cv::warpAffine(image, patch, M, WindowSize, flags, cv::BORDER_REFLECT);
+    });
+}
+
+BENCHMARK(BM_WarpAffine)->ArgsProduct({{480, 1080}, {64, 128, 256, 512}});
+
+void BM_SeparableCrop(benchmark::State& state)
+{
+    cropObjects(state, [] (const cv::Mat& image, cv::Mat& patch, const cv::Matx23f& M, cv::InterpolationFlags flags) {
+        pav1iet::resampleAxisAligned(image, patch, M, WindowSize, flags);
+    });
+}
+
+BENCHMARK(BM_SeparableCrop)->ArgsProduct({{480, 1080}, {64, 128, 256, 512}});
+
+// Encodes a padded window at the given PNG compression level
+void BM_EncodePng(benchmark::State& state)
+{
+    cv::RNG rng;
+    const cv::Mat patch = pav1iet::randomImage(rng, WindowSize + cv::Size{Padding, Padding} * 2);
+    const std::vector<int> params{cv::IMWRITE_PNG_COMPRESSION, static_cast<int>(state.range(0))};
+
+    std::vector<uchar> encoded;
+
+    for (auto _ : state) {
+        if (!cv::imencode(".png", patch, encoded, params)) {
+            state.SkipWithError("failed to encode the patch");
+            break;
+        }
+    }
+
+    state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(patch.total() * patch.elemSize()));
+    state.counters["encoded_bytes"] = static_cast<double>(encoded.size());
+}
+
+BENCHMARK(BM_EncodePng)->DenseRange(0, 9, 3);
+
+// Runs the pav1iet executable on a synthetic dataset. Arguments are the
+// number of images, the number of objects per image and the image height.
+// Crowded images exercise the extraction of the objects of a single image in
+// parallel.
+void BM_EndToEnd(benchmark::State& state)
+{
+    pav1iet::DatasetSpec spec;
+    spec.numImages = static_cast<std::size_t>(state.range(0));
+    spec.objectsPerImage = static_cast<std::size_t>(state.range(1));
+    spec.imageSize = cv::Size{static_cast<int>(state.range(2)) * 4 / 3, static_cast<int>(state.range(2))};
+
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() /
+        std::format("pav1iet-bench-{}-{}-{}", state.range(0), state.range(1), state.range(2));
+    const std::filesystem::path outputDirectory = directory / "patches";
+
+    std::filesystem::path listingFileName = directory / "listing.lst";
+
+    // Datasets are reused across benchmark runs
+    if (!std::filesystem::exists(listingFileName)) {
+        listingFileName = pav1iet::generateDataset(directory, spec);
+    }
+
+    std::filesystem::create_directories(outputDirectory);
+
+    const std::string command = std::format("\"{}\" \"{}\" -o \"{}\" 2> {}", PAV1IET_EXECUTABLE,
+                                            listingFileName.string(), (outputDirectory / "patch").string(),
+#ifdef _WIN32
+                                            "NUL"
+#else
+                                            "/dev/null"
+#endif
+    );
+
+    for (auto _ : state) {
+        if (std::system(command.c_str()) != 0) {
+            state.SkipWithError("pav1iet failed");
+            break;
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0) * state.range(1));
+}
+
+BENCHMARK(BM_EndToEnd)
+    ->Args({256, 2, 480})
+    ->Args({256, 8, 480})
+    ->Args({64, 2, 1080})
+    ->Args({64, 48, 1080})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime()
+    ->MeasureProcessCPUTime();
+
+} // namespace
+
+BENCHMARK_MAIN();
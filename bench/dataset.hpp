@@ -0,0 +1,175 @@
+//
+// pav1iet - PASCAL Annotation Version 1.00 Extractor Tool
+// Copyright (C) 2026 Sergiu Deitsch <sergiu.deitsch@gmail.com>
+//
+// This file is part of pav1iet.
+//
+// pav1iet is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pav1iet is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pav1iet.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef PAV1IET_BENCH_DATASET_HPP
+#define PAV1IET_BENCH_DATASET_HPP
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgcodecs/imgcodecs.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace pav1iet {
+
+// Scale of a synthetic dataset
+struct DatasetSpec
+{
+    std::size_t numImages = 100;
+    std::size_t objectsPerImage = 2;
+    cv::Size imageSize{640, 480};
+    // Seed of the random number generator. Equal seeds yield identical
+    // datasets.
+    unsigned seed = 0;
+};
+
+// Bounding boxes of upright standing persons with an aspect ratio of 1:2
+// placed randomly within the image.
+[[nodiscard]] inline std::vector<cv::Rect> randomBoxes(cv::RNG& rng, const cv::Size& imageSize, std::size_t count)
+{
+    std::vector<cv::Rect> boxes;
+    boxes.reserve(count);
+
+    const int minHeight = std::max(imageSize.height / 4, 2);
+    const int maxHeight = std::max(imageSize.height * 3 / 4, minHeight + 1);
+
+    for (std::size_t i = 0; i != count; ++i) {
+        const int height = std::min(rng.uniform(minHeight, maxHeight), imageSize.height);
+        const int width = std::min(std::max(height / 2, 1), imageSize.width);
+        const int x = rng.uniform(0, imageSize.width - width + 1);
+        const int y = rng.uniform(0, imageSize.height - height + 1);
+
+        boxes.emplace_back(x, y, width, height);
+    }
+
+    return boxes;
+}
+
+// Smoothed noise which compresses similar to natural images
+[[nodiscard]] inline cv::Mat randomImage(cv::RNG& rng, const cv::Size& size)
+{
+    cv::Mat image{size, CV_8UC3};
+    rng.fill(image, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(256));
+    cv::GaussianBlur(image, image, cv::Size{}, 2);
+
+    return image;
+}
+
+// Formats the annotations of a single image the same way as the INRIA person
+// dataset does.
+[[nodiscard]] inline std::string makeAnnotation(const std::string& imageFileName, const cv::Size& imageSize,
+                                                const std::vector<cv::Rect>& boxes)
+{
+    std::string text = std::format(
+        "# PASCAL Annotation Version 1.00\n"
+        "\n"
+        "Image filename : \"{}\"\n"
+        "Image size (X x Y x C) : {} x {} x 3\n"
+        "Database : \"Synthetic pav1iet benchmark database\"\n"
+        "Objects with ground truth : {} {{",
+        imageFileName, imageSize.width, imageSize.height, boxes.size());
+
+    for (std::size_t i = 0; i != boxes.size(); ++i) {
+        text += " \"PASperson\"";
+    }
+
+    text +=
+        " }\n"
+        "\n"
+        "# Note that there might be other objects in the image\n"
+        "# for which ground truth data has not been provided.\n"
+        "\n"
+        "# Top left pixel co-ordinates : (0, 0)\n";
+
+    for (std::size_t i = 0; i != boxes.size(); ++i) {
+        const cv::Rect& box = boxes[i];
+        const std::size_t id = i + 1;
+
+        text += std::format(
+            "\n"
+            "# Details for object {0} (\"PASperson\")\n"
+            "# Center point -- not available in other PASCAL databases -- refers\n"
+            "# to person head center\n"
+            "Original label for object {0} \"PASperson\" : \"UprightPerson\"\n"
+            "Center point on object {0} \"PASperson\" (X, Y) : ({1}, {2})\n"
+            "Bounding box for object {0} \"PASperson\" (Xmin, Ymin) - (Xmax, Ymax) : ({3}, {4}) - ({5}, {6})\n",
+            id, box.x + box.width / 2, box.y + box.height / 8, box.x, box.y, box.x + box.width,
+            box.y + box.height);
+    }
+
+    return text;
+}
+
+// Writes the images, the annotation files and a listing of the annotation
+// files into the directory. Returns the file name of the listing.
+inline std::filesystem::path generateDataset(const std::filesystem::path& directory, const DatasetSpec& spec)
+{
+    if (spec.imageSize.width < 2 || spec.imageSize.height < 2) {
+        throw std::invalid_argument{"synthetic images must be at least 2x2 pixels large"};
+    }
+
+    std::filesystem::create_directories(directory / "images");
+    std::filesystem::create_directories(directory / "annotations");
+
+    cv::RNG rng{spec.seed};
+
+    std::string listing;
+
+    for (std::size_t i = 0; i != spec.numImages; ++i) {
+        const std::string imageFileName = std::format("images/{:06}.png", i);
+        const std::string annotationFileName = std::format("annotations/{:06}.txt", i);
+
+        if (!cv::imwrite((directory / imageFileName).string(), randomImage(rng, spec.imageSize))) {
+            throw std::runtime_error{"failed to write " + (directory / imageFileName).string()};
+        }
+
+        std::ofstream out{directory / annotationFileName};
+        out << makeAnnotation(imageFileName, spec.imageSize,
+                              randomBoxes(rng, spec.imageSize, spec.objectsPerImage));
+
+        if (!out) {
+            throw std::runtime_error{"failed to write " + (directory / annotationFileName).string()};
+        }
+
+        listing += annotationFileName + '\n';
+    }
+
+    // The listing is written last such that its presence indicates a
+    // complete dataset.
+    const std::filesystem::path listingFileName = directory / "listing.lst";
+    std::ofstream out{listingFileName};
+
+    if (!(out << listing)) {
+        throw std::runtime_error{"failed to write " + listingFileName.string()};
+    }
+
+    return listingFileName;
+}
+
+} // namespace pav1iet
+
+#endif // PAV1IET_BENCH_DATASET_HPP
@@ -0,0 +1,82 @@
+//
+// pav1iet - PASCAL Annotation Version 1.00 Extractor Tool
+// Copyright (C) 2026 Sergiu Deitsch <sergiu.deitsch@gmail.com>
+//
+// This file is part of pav1iet.
+//
+// pav1iet is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pav1iet is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pav1iet.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <boost/program_options.hpp>
+
+#include "dataset.hpp"
+
+int main(int argc, char** argv)
+{
+    namespace po = boost::program_options;
+
+    po::options_description opts{"available options"};
+
+    std::filesystem::path directory;
+    pav1iet::DatasetSpec spec;
+    std::string imageSize = "640x480";
+
+    opts.add_options()
+        ("output,o", (po::value(&directory)->required())->value_name("<dir>"), "output directory")
+        ("images", (po::value(&spec.numImages)->default_value(spec.numImages))->value_name("<n>"),
+            "number of images")
+        ("objects", (po::value(&spec.objectsPerImage)->default_value(spec.objectsPerImage))->value_name("<n>"),
+            "number of objects per image")
+        ("size", (po::value(&imageSize)->default_value(imageSize))->value_name("<W>x<H>"),
+            "image resolution")
+        ("seed", (po::value(&spec.seed)->default_value(spec.seed))->value_name("<n>"),
+            "random number generator seed")
+        ("help,h", "show this help message")
+        ;
+
+    try {
+        po::variables_map vars;
+        po::store(po::parse_command_line(argc, argv, opts), vars);
+
+        if (vars.count("help") != 0u) {
+            std::cout << "usage: pav1iet-dataset -o <dir> [options]\n\n" << opts;
+            return EXIT_SUCCESS;
+        }
+
+        po::notify(vars);
+
+        char x;
+
+        if (std::istringstream in{imageSize};
+            !(in >> spec.imageSize.width >> x >> spec.imageSize.height) || x != 'x') {
+            std::cerr << "error: invalid image size " << imageSize << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        std::cout << pav1iet::generateDataset(directory, spec).string() << std::endl;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
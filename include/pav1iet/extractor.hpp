@@ -0,0 +1,398 @@
+//
+// pav1iet - PASCAL Annotation Version 1.00 Extractor Tool
+// Copyright (C) 2026 Sergiu Deitsch <sergiu.deitsch@gmail.com>
+//
+// This file is part of pav1iet.
+//
+// pav1iet is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pav1iet is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pav1iet.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef PAV1IET_EXTRACTOR_HPP
+#define PAV1IET_EXTRACTOR_HPP
+
+#include <opencv2/core/core.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace pav1iet {
+
+// Specifies how annotation files are brought into memory before parsing.
+enum class AnnotationInput
+{
+    // Parse directly from an std::ifstream using a multi-pass iterator.
+    stream,
+    // Read the whole file into a heap buffer using a single read call.
+    read,
+    // Map the file into memory.
+    map
+};
+
+std::istream& operator>>(std::istream& in, AnnotationInput& value);
+std::ostream& operator<<(std::ostream& out, AnnotationInput value);
+
+// Implementation of the annotation parser
+enum class AnnotationParser
+{
+    // Boost.Spirit X3 grammar
+    x3,
+    // Hand-written parser of contiguous buffers
+    fast
+};
+
+std::istream& operator>>(std::istream& in, AnnotationParser& value);
+std::ostream& operator<<(std::ostream& out, AnnotationParser value);
+
+// Implementation used for extracting the patches
+enum class CropKernel
+{
+    // General cv::warpAffine
+    warp,
+    // Separable resampling of axis-aligned transformations
+    separable
+};
+
+std::istream& operator>>(std::istream& in, CropKernel& value);
+std::ostream& operator<<(std::ostream& out, CropKernel value);
+
+// Reads annotation files and images ahead of the pipeline
+enum class IoEngine
+{
+    // Blocking reads on the pipeline threads
+    sync,
+    // Blocking reads on dedicated threads
+    threads,
+    // Batched asynchronous reads using io_uring (Linux only)
+    uring
+};
+
+std::istream& operator>>(std::istream& in, IoEngine& value);
+std::ostream& operator<<(std::ostream& out, IoEngine value);
+
+// Pixels of the extracted patches
+enum class PixelFormat
+{
+    // 8-bit BGR
+    bgr8,
+    // 8-bit grayscale
+    gray8,
+    // Grayscale floating point values in [0, 1]
+    gray32f,
+    // BGR floating point values in [0, 1]
+    bgr32f
+};
+
+std::istream& operator>>(std::istream& in, PixelFormat& value);
+std::ostream& operator<<(std::ostream& out, PixelFormat value);
+
+// OpenCV type of the patches of the given pixel format, e.g., CV_32FC1
+[[nodiscard]] int patchType(PixelFormat format) noexcept;
+
+// Standardizes each channel of floating point patches as (value - mean) /
+// std. The statistics refer to values in [0, 1]; unused channels are
+// ignored.
+struct Normalization
+{
+    cv::Scalar mean = cv::Scalar::all(0);
+    cv::Scalar std = cv::Scalar::all(1);
+};
+
+// Detection window the objects are cropped to
+struct Window
+{
+    cv::Size windowSize{64, 128};
+    // Horizontal padding on one side; the vertical padding keeps the aspect
+    // ratio of the window
+    int padding = 16;
+};
+
+// Background windows sampled from each image in addition to the objects
+struct NegativeSampling
+{
+    // Windows sampled per image and detection window
+    std::size_t count = 0;
+    // Maximum intersection with any annotated bounding box relative to the
+    // smaller of the window and the box
+    double maxOverlap = 0;
+};
+
+// Additional patches of each object obtained by modifying the window
+struct Augmentation
+{
+    // Add the mirror image of each patch
+    bool flip = false;
+    // Randomly translated and scaled copies of each patch
+    std::size_t jitter = 0;
+    // Maximum translation of the copies in window pixels
+    double translation = 0;
+    // Maximum relative change of the scale of the copies
+    double scale = 0;
+};
+
+struct ExtractorOptions
+{
+    AnnotationInput annotationInput = AnnotationInput::map;
+    AnnotationParser annotationParser = AnnotationParser::x3;
+    // Parse each annotation file using both parsers and compare the results
+    bool verifyParser = false;
+    // Zero means unlimited
+    std::ptrdiff_t maxConcurrentReads = 0;
+    IoEngine ioEngine = IoEngine::sync;
+    // Number of annotation files read ahead of the pipeline by an
+    // asynchronous I/O engine. Their images are read as soon as the
+    // annotations are parsed.
+    std::size_t readAhead = 16;
+    // Decode images at the coarsest resolution that avoids upsampling
+    bool reducedDecode = false;
+    CropKernel cropKernel = CropKernel::warp;
+    // Maximum absolute difference between the patches of both crop kernels
+    std::optional<double> verifyCropKernel;
+    // Grayscale formats decode only a single channel. The conversion to
+    // floating point values is applied to the patches while they are
+    // cropped.
+    PixelFormat pixelFormat = PixelFormat::bgr8;
+    // Requires a floating point pixel format
+    std::optional<Normalization> normalization;
+    // Patches extracted from each image
+    std::vector<Window> windows{Window{}};
+    NegativeSampling negatives;
+    Augmentation augmentation;
+    // Seed of the random sampling. The samples of an image depend only on
+    // the seed and the image file name.
+    std::uint64_t seed = 0;
+    // Tar archive the annotation files and images are read from in place of
+    // the file system. All the file names are resolved to members of the
+    // archive. Disabled if empty.
+    std::filesystem::path archive;
+    // Directory of the persistent decoded image cache. Disabled if empty.
+    std::filesystem::path imageCache;
+    std::uintmax_t imageCacheSize = std::uintmax_t{4} << 30;
+    // Manifest of a resumable extraction. Disabled if empty.
+    std::filesystem::path manifest;
+    // Hash of the consumer settings that affect the stored patches. A
+    // different value than the one of the previous run discards the
+    // manifest.
+    std::uint64_t consumerParametersHash = 0;
+    // Collect per-stage pipeline statistics
+    bool stats = false;
+    // Chrome trace event file of the pipeline stages. Disabled if empty.
+    std::filesystem::path trace;
+    // Maximum memory held by decoded images and patches. Zero means
+    // unlimited.
+    std::uintmax_t memoryBudget = 0;
+    // Parse all the annotation files before extracting any patches and
+    // process the images in decreasing order of their estimated cost such
+    // that a few large images do not leave a single-threaded tail. The
+    // output indices are still assigned in listing order.
+    bool largestFirst = false;
+    // Maximum number of annotation files in flight. Zero selects a default
+    // based on the number of cores.
+    std::size_t maxTokens = 0;
+    // Receives a continuously updated progress line. Disabled if null.
+    std::ostream* progress = nullptr;
+};
+
+// Annotated object a patch was cropped from. For negative windows, the id is
+// zero, the strings are empty and the bounding box is the sampled region.
+struct ObjectInfo
+{
+    unsigned id;
+    std::string_view name;
+    std::string_view label;
+    cv::Point centerPoint;
+    cv::Rect boundingBox;
+};
+
+// Describes the origin of an extracted patch. The referenced strings are
+// valid only while the patch is being consumed.
+struct PatchInfo
+{
+    // Output index of the patch
+    std::size_t index;
+    // Index of the window in ExtractorOptions::windows
+    std::size_t window;
+    // Annotation file the object is defined in
+    const std::filesystem::path& annotationFileName;
+    ObjectInfo object;
+    // Maps full resolution source image coordinates to patch coordinates
+    cv::Matx23f transform;
+    // Whether the patch is a negative window. Negative windows are numbered
+    // separately for each detection window.
+    bool negative = false;
+    // Augmented variant of the object. Zero denotes the original patch. The
+    // variants of an object are numbered consecutively.
+    std::size_t variant = 0;
+};
+
+// Annotation files discovered by recursively traversing directories
+struct DirectoryScan
+{
+    std::vector<std::filesystem::path> directories;
+    // Glob the file names are matched against
+    std::string pattern = "*.txt";
+    // Process the files in lexicographical order of their paths to obtain
+    // the same output indices in each run. Otherwise, files are processed as
+    // soon as they are discovered while the traversal is still running.
+    bool sorted = false;
+};
+
+// Called concurrently from multiple threads for each extracted patch in
+// arbitrary order. The extraction stalls while the consumer is busy. The
+// pixels are recycled once the last reference to the patch is released.
+using PatchConsumer = std::function<void(const PatchInfo& info, const cv::Mat& patch)>;
+
+struct ExtractionSummary
+{
+    // Annotation files listed
+    std::size_t numFiles = 0;
+    std::size_t numObjects = 0;
+    // Patches passed to the consumer including the negative windows
+    std::size_t numPatches = 0;
+    std::size_t numNegatives = 0;
+    // Annotation files whose patches were up to date according to the
+    // manifest
+    std::size_t numSkippedFiles = 0;
+    // Output indices [firstStaleIndex, endStaleIndex) written by previous runs
+    // according to the manifest that are no longer produced, e.g., because
+    // annotation files were removed. Their patches should be deleted.
+    std::size_t firstStaleIndex = 0;
+    std::size_t endStaleIndex = 0;
+    std::size_t imageCacheHits = 0;
+    std::size_t imageCacheMisses = 0;
+};
+
+// Extracts the patches of the objects in PASCAL annotation files
+class Extractor
+{
+public:
+    // Opens the image cache and the manifest. Throws std::invalid_argument
+    // or std::runtime_error on failure.
+    explicit Extractor(ExtractorOptions options);
+    ~Extractor();
+
+    Extractor(const Extractor&) = delete;
+    Extractor& operator=(const Extractor&) = delete;
+
+    [[nodiscard]] const ExtractorOptions& options() const noexcept;
+
+    // Whether the manifest was ignored because the extraction parameters
+    // changed since the previous run
+    [[nodiscard]] bool manifestDiscarded() const noexcept;
+
+    // Reason the files are read on dedicated threads although io_uring was
+    // requested, e.g., because the kernel does not support it. Empty if the
+    // requested I/O engine is used.
+    [[nodiscard]] std::string_view ioEngineFallback() const noexcept;
+
+    // Processes the annotation files listed one per line relative to the
+    // directory and passes the resulting patches to the consumer. Patches
+    // are numbered in listing order. Can be invoked only once per extractor.
+    // Exceptions thrown while processing, including those of the consumer,
+    // cancel the extraction and are rethrown.
+    ExtractionSummary run(std::istream& listing, const std::filesystem::path& directory,
+                          const PatchConsumer& consumer);
+
+    // Same as above, but processes the annotation files found by scanning
+    // directories. Image file names are relative to the root directory.
+    ExtractionSummary run(const DirectoryScan& scan, const std::filesystem::path& root,
+                          const PatchConsumer& consumer);
+
+    // Contents of a member of ExtractorOptions::archive, e.g., the listing.
+    // The view remains valid for the lifetime of the extractor. Throws
+    // std::runtime_error if the member does not exist.
+    [[nodiscard]] std::string_view archiveMember(const std::filesystem::path& name) const;
+
+    // Prints the statistics collected if ExtractorOptions::stats is set
+    void printStatistics(std::ostream& out, std::uintmax_t bytesWritten) const;
+
+private:
+    struct Impl;
+
+    // Runs the pipeline on the annotation files returned by nextFile until
+    // it returns false
+    ExtractionSummary process(const std::function<bool(std::filesystem::path&)>& nextFile,
+                              const std::filesystem::path& directory, const PatchConsumer& consumer);
+
+    std::unique_ptr<Impl> impl_;
+};
+
+// Patch handed out by a PatchStream
+struct Patch
+{
+    std::size_t index;
+    std::size_t window;
+    std::filesystem::path annotationFileName;
+    unsigned objectId;
+    std::string objectName;
+    std::string label;
+    cv::Point centerPoint;
+    cv::Rect boundingBox;
+    cv::Matx23f transform;
+    bool negative;
+    std::size_t variant;
+    // Refers to memory owned by the extractor and must be released before
+    // the extractor is destroyed
+    cv::Mat image;
+};
+
+// Runs an extractor in the background and hands out the patches one by one.
+// At most the given number of patches are buffered after which the
+// extraction stalls until patches are consumed.
+class PatchStream
+{
+public:
+    PatchStream(Extractor& extractor, std::istream& listing, std::filesystem::path directory,
+                std::size_t capacity = 1024);
+    PatchStream(Extractor& extractor, DirectoryScan scan, std::filesystem::path root,
+                std::size_t capacity = 1024);
+    // Cancels the extraction unless all the patches have been consumed
+    ~PatchStream();
+
+    PatchStream(const PatchStream&) = delete;
+    PatchStream& operator=(const PatchStream&) = delete;
+
+    // Blocks until the next patch becomes available. Returns std::nullopt
+    // once the extraction is done and rethrows its error if it failed.
+    [[nodiscard]] std::optional<Patch> next();
+
+    // Available once next returned std::nullopt
+    [[nodiscard]] const ExtractionSummary& summary() const noexcept;
+
+private:
+    struct Queue;
+
+    // Starts the producer thread running the extraction
+    void start(std::function<ExtractionSummary(const PatchConsumer&)> run);
+
+    std::unique_ptr<Queue> queue_;
+    // Whether the end of the stream was reached
+    bool done_ = false;
+    ExtractionSummary summary_;
+    std::exception_ptr error_;
+    std::thread producer_;
+};
+
+} // namespace pav1iet
+
+#endif // PAV1IET_EXTRACTOR_HPP
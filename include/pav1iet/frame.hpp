@@ -0,0 +1,112 @@
+//
+// pav1iet - PASCAL Annotation Version 1.00 Extractor Tool
+// Copyright (C) 2026 Sergiu Deitsch <sergiu.deitsch@gmail.com>
+//
+// This file is part of pav1iet.
+//
+// pav1iet is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pav1iet is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pav1iet.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef PAV1IET_FRAME_HPP
+#define PAV1IET_FRAME_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Binary format of the patches streamed to standard output or a shared
+// memory ring buffer. All the fields use the byte order of the host.
+
+namespace pav1iet {
+
+// The last character is the version of the frame format
+inline constexpr char FrameMagic[4] = {'P', 'V', 'F', '2'};
+
+// Frame type that marks the remainder of the ring buffer data area as unused
+inline constexpr std::int32_t WrapFrameType = -1;
+
+// Bits of FrameHeader::flags
+inline constexpr std::uint32_t NegativeFrameFlag = 1;
+
+// Precedes the pixels of each patch
+struct FrameHeader
+{
+    char magic[4];
+    // Index of the window the patch was extracted for
+    std::uint32_t window;
+    // Output index of the patch
+    std::uint64_t index;
+    // Object id within the annotation file. Zero for negative windows.
+    std::uint32_t objectId;
+    // Combination of the frame flags, e.g., NegativeFrameFlag
+    std::uint32_t flags;
+    // Augmented variant of the object. Zero denotes the original patch.
+    std::uint32_t variant;
+    std::int32_t rows;
+    std::int32_t cols;
+    // OpenCV matrix type, e.g., CV_8UC3
+    std::int32_t type;
+    // Number of pixel bytes following the header. Rows are not padded.
+    std::uint64_t size;
+};
+
+static_assert(sizeof(FrameHeader) == 48);
+
+// Frames within the ring buffer start at multiples of the alignment
+inline constexpr std::size_t FrameAlignment = alignof(FrameHeader);
+
+[[nodiscard]] constexpr std::uint64_t alignedFrameSize(std::uint64_t payloadSize) noexcept
+{
+    return (sizeof(FrameHeader) + payloadSize + FrameAlignment - 1) / FrameAlignment * FrameAlignment;
+}
+
+inline constexpr char RingMagic[8] = {'P', 'A', 'V', '1', 'R', 'I', 'N', 'G'};
+
+enum class RingState : std::uint32_t
+{
+    // The producer has not finished initializing the header
+    initializing,
+    open,
+    // No more frames will be published
+    closed
+};
+
+// Start of the shared memory object followed by the data area. The producer
+// publishes frames by advancing head, the consumer releases them by
+// advancing tail. Both counters are byte offsets that increase monotonically;
+// frames are located at their value modulo the capacity. A frame never wraps
+// around the end of the data area. If the space left before the end is too
+// small for the next frame, the producer skips it after writing a frame of
+// WrapFrameType there if the header fits. The consumer must therefore skip
+// to the start once a wrap frame is encountered or less than
+// sizeof(FrameHeader) bytes remain. All the frames have been consumed once
+// the ring is closed and the tail reached the head.
+struct RingHeader
+{
+    char magic[8];
+    // Size of the data area in bytes
+    std::uint64_t capacity;
+    std::atomic<RingState> state;
+    alignas(64) std::atomic<std::uint64_t> head;
+    alignas(64) std::atomic<std::uint64_t> tail;
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+
+// Offset of the data area within the shared memory object
+inline constexpr std::size_t RingDataOffset = (sizeof(RingHeader) + 63) / 64 * 64;
+
+} // namespace pav1iet
+
+#endif // PAV1IET_FRAME_HPP
@@ -0,0 +1,186 @@
+//
+// pav1iet - PASCAL Annotation Version 1.00 Extractor Tool
+// Copyright (C) 2026 Sergiu Deitsch <sergiu.deitsch@gmail.com>
+//
+// This file is part of pav1iet.
+//
+// pav1iet is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pav1iet is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pav1iet.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef PAV1IET_ARENA_HPP
+#define PAV1IET_ARENA_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace pav1iet {
+
+// Bump allocator whose memory is released only as a whole. Unlike
+// std::pmr::monotonic_buffer_resource, resetting the arena keeps the blocks
+// allocated so far such that a reused arena eventually stops allocating.
+class Arena final : public std::pmr::memory_resource
+{
+public:
+    explicit Arena(std::size_t blockSize = 4096)
+        : blockSize_{blockSize}
+    {
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Makes the whole memory available again. All the objects allocated from
+    // the arena must have been destroyed.
+    void reset() noexcept
+    {
+        current_ = 0;
+        offset_ = 0;
+    }
+
+    // Total size of the blocks owned by the arena
+    [[nodiscard]] std::size_t capacity() const noexcept
+    {
+        std::size_t size = 0;
+
+        for (const Block& block : blocks_) {
+            size += block.size;
+        }
+
+        return size;
+    }
+
+private:
+    struct Block
+    {
+        struct Free
+        {
+            void operator()(std::byte* p) const noexcept
+            {
+                ::operator delete(p, std::align_val_t{alignof(std::max_align_t)});
+            }
+        };
+
+        std::unique_ptr<std::byte[], Free> data;
+        std::size_t size;
+    };
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        for (; current_ != blocks_.size(); ++current_, offset_ = 0) {
+            Block& block = blocks_[current_];
+
+            void* p = block.data.get() + offset_;
+            std::size_t space = block.size - offset_;
+
+            if (std::align(alignment, bytes, p, space) != nullptr) {
+                offset_ = block.size - space + bytes;
+                return p;
+            }
+        }
+
+        // Grow geometrically to bound the number of blocks
+        const std::size_t size =
+            std::max(blocks_.empty() ? blockSize_ : blocks_.back().size * 2, bytes + alignment);
+
+        blocks_.push_back(Block{std::unique_ptr<std::byte[], Block::Free>{static_cast<std::byte*>(
+                                    ::operator new(size, std::align_val_t{alignof(std::max_align_t)}))},
+                                size});
+
+        return do_allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* /*p*/, std::size_t /*bytes*/, std::size_t /*alignment*/) override
+    {
+        // Memory is reclaimed by reset()
+    }
+
+    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    std::size_t blockSize_;
+    std::vector<Block> blocks_;
+    // Block and offset of the next allocation
+    std::size_t current_ = 0;
+    std::size_t offset_ = 0;
+};
+
+// Recycles arenas. Arenas are returned to the pool and reset once their
+// handle is destroyed.
+class ArenaPool
+{
+    struct Recycle
+    {
+        void operator()(Arena* arena) const noexcept
+        {
+            arena->reset();
+            pool->release(arena);
+        }
+
+        ArenaPool* pool;
+    };
+
+public:
+    using Handle = std::unique_ptr<Arena, Recycle>;
+
+    ArenaPool() = default;
+    ArenaPool(const ArenaPool&) = delete;
+    ArenaPool& operator=(const ArenaPool&) = delete;
+
+    [[nodiscard]] Handle acquire()
+    {
+        std::scoped_lock lock{mutex_};
+
+        if (available_.empty()) {
+            arenas_.push_back(std::make_unique<Arena>());
+            // Releasing arenas must not allocate
+            available_.reserve(arenas_.size());
+
+            return Handle{arenas_.back().get(), Recycle{this}};
+        }
+
+        Arena* const arena = available_.back();
+        available_.pop_back();
+
+        return Handle{arena, Recycle{this}};
+    }
+
+    // Number of arenas created so far
+    [[nodiscard]] std::size_t size() const
+    {
+        std::scoped_lock lock{mutex_};
+        return arenas_.size();
+    }
+
+private:
+    void release(Arena* arena) noexcept
+    {
+        std::scoped_lock lock{mutex_};
+        available_.push_back(arena);
+    }
+
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Arena> > arenas_;
+    std::vector<Arena*> available_;
+};
+
+} // namespace pav1iet
+
+#endif // PAV1IET_ARENA_HPP
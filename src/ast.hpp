@@ -0,0 +1,177 @@
+//
+// Copyright (c) 2020 Sergiu Deitsch <sergiu.deitsch@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//  * Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimer in the documentation
+// and/or other materials provided with the distribution.
+//  * Neither the name of %ORGANIZATION% nor the names of its contributors may
+// be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef PAV1IET_AST_HPP
+#define PAV1IET_AST_HPP
+
+#include <opencv2/core/core.hpp>
+
+#include <filesystem>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pascal_v1 {
+
+namespace ast {
+
+struct Object
+{
+    unsigned id;
+    std::string name;
+    std::string label;
+    cv::Point centerPoint;
+    cv::Rect boundingBox;
+
+    bool operator==(const Object& other) const = default;
+};
+
+struct Annotations
+{
+    std::filesystem::path imageFileName;
+    cv::Size imageSize;
+    int channels;
+    std::string database;
+    // Objects with ground truth
+    std::vector<std::string> objectNames;
+    cv::Point topLeft;
+    std::vector<Object> objects;
+
+    bool operator==(const Annotations& other) const = default;
+};
+
+// Counterparts of the above whose strings and containers are allocated from
+// a memory resource, typically an arena that is reused for each annotation
+// file.
+namespace pmr {
+
+struct Object
+{
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    explicit Object(const allocator_type& alloc = {})
+        : name{alloc}
+        , label{alloc}
+    {
+    }
+
+    Object(unsigned id, std::string_view name, std::string_view label, const cv::Point& centerPoint,
+           const cv::Rect& boundingBox, const allocator_type& alloc = {})
+        : id{id}
+        , name{name, alloc}
+        , label{label, alloc}
+        , centerPoint{centerPoint}
+        , boundingBox{boundingBox}
+    {
+    }
+
+    Object(const Object& other, const allocator_type& alloc)
+        : Object{other.id, other.name, other.label, other.centerPoint, other.boundingBox, alloc}
+    {
+    }
+
+    Object(Object&& other, const allocator_type& alloc)
+        : Object{other, alloc}
+    {
+    }
+
+    Object(const Object& other) = default;
+    Object(Object&& other) noexcept = default;
+    Object& operator=(const Object& other) = default;
+    Object& operator=(Object&& other) = default;
+
+    unsigned id = 0;
+    std::pmr::string name;
+    std::pmr::string label;
+    cv::Point centerPoint;
+    cv::Rect boundingBox;
+};
+
+struct Annotations
+{
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    explicit Annotations(const allocator_type& alloc = {})
+        : imageFileName{alloc}
+        , database{alloc}
+        , objectNames{alloc}
+        , objects{alloc}
+    {
+    }
+
+    Annotations(Annotations&& other) noexcept = default;
+    Annotations& operator=(Annotations&& other) = default;
+
+    // Copies the annotations produced by the grammar
+    void assign(const ast::Annotations& other)
+    {
+        imageFileName = other.imageFileName.string();
+        imageSize = other.imageSize;
+        channels = other.channels;
+        database = other.database;
+        objectNames.assign(other.objectNames.begin(), other.objectNames.end());
+        topLeft = other.topLeft;
+        objects.clear();
+        objects.reserve(other.objects.size());
+
+        for (const ast::Object& object : other.objects) {
+            objects.emplace_back(object.id, object.name, object.label, object.centerPoint, object.boundingBox);
+        }
+    }
+
+    // Copies annotations allocated from another memory resource into the
+    // memory resource of this instance
+    void assign(const Annotations& other)
+    {
+        imageFileName = other.imageFileName;
+        imageSize = other.imageSize;
+        channels = other.channels;
+        database = other.database;
+        objectNames = other.objectNames;
+        topLeft = other.topLeft;
+        objects = other.objects;
+    }
+
+    std::pmr::string imageFileName;
+    cv::Size imageSize;
+    int channels = 0;
+    std::pmr::string database;
+    std::pmr::vector<std::pmr::string> objectNames;
+    cv::Point topLeft;
+    std::pmr::vector<Object> objects;
+};
+
+} // namespace pmr
+
+} // namespace ast
+
+} // namespace pascal_v1
+
+#endif // PAV1IET_AST_HPP
@@ -0,0 +1,547 @@
+//
+// pav1iet - PASCAL Annotation Version 1.00 Extractor Tool
+// Copyright (C) 2026 Sergiu Deitsch <sergiu.deitsch@gmail.com>
+//
+// This file is part of pav1iet.
+//
+// pav1iet is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pav1iet is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pav1iet.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef PAV1IET_ASYNC_READER_HPP
+#define PAV1IET_ASYNC_READER_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef PAV1IET_HAVE_LIBURING
+#include <fcntl.h>
+#include <liburing.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // PAV1IET_HAVE_LIBURING
+
+#include "file_buffer.hpp"
+
+namespace pav1iet {
+
+// Reads whole files into memory in the background such that the pipeline
+// threads do not block on reads of files that were requested early enough.
+class AsyncReader
+{
+public:
+    virtual ~AsyncReader() = default;
+
+    // Starts reading the file. Errors are reported by the future.
+    [[nodiscard]] virtual std::future<FileBuffer> read(std::filesystem::path fileName) = 0;
+
+protected:
+    struct Request
+    {
+        std::filesystem::path fileName;
+        std::promise<FileBuffer> promise;
+    };
+};
+
+// Reads the files using blocking reads on dedicated threads. The number of
+// threads bounds the number of reads in progress.
+class ThreadPoolReader final : public AsyncReader
+{
+public:
+    explicit ThreadPoolReader(std::size_t numThreads)
+    {
+        for (std::size_t i = 0; i != std::max<std::size_t>(numThreads, 1); ++i) {
+            threads_.emplace_back([this] {
+                run();
+            });
+        }
+    }
+
+    ~ThreadPoolReader() override
+    {
+        {
+            std::scoped_lock lock{mutex_};
+            stopping_ = true;
+        }
+
+        requested_.notify_all();
+
+        for (std::thread& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    [[nodiscard]] std::future<FileBuffer> read(std::filesystem::path fileName) override
+    {
+        Request request{std::move(fileName), {}};
+        std::future<FileBuffer> result = request.promise.get_future();
+
+        {
+            std::scoped_lock lock{mutex_};
+            requests_.push_back(std::move(request));
+        }
+
+        requested_.notify_one();
+
+        return result;
+    }
+
+private:
+    void run()
+    {
+        for (;;) {
+            Request request;
+
+            {
+                std::unique_lock lock{mutex_};
+
+                requested_.wait(lock, [this] {
+                    return stopping_ || !requests_.empty();
+                });
+
+                if (requests_.empty()) {
+                    return;
+                }
+
+                request = std::move(requests_.front());
+                requests_.pop_front();
+            }
+
+            try {
+                request.promise.set_value(FileBuffer::read(request.fileName));
+            }
+            catch (...) {
+                request.promise.set_exception(std::current_exception());
+            }
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable requested_;
+    std::deque<Request> requests_;
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+};
+
+#ifdef PAV1IET_HAVE_LIBURING
+
+// Submits the reads of many files in batches to an io_uring instance owned by
+// a single thread. Opening a file, querying its size and reading its contents
+// are all asynchronous such that high-latency storage is kept busy with many
+// files at once. At most depth files are in flight. Files whose size is not
+// known in advance, e.g., pipes, are read from their open descriptor by a
+// helper thread instead such that they do not stall the ring.
+class UringReader final : public AsyncReader
+{
+public:
+    // Throws std::runtime_error if io_uring is not usable, e.g., because the
+    // kernel is too old or io_uring is disabled.
+    explicit UringReader(unsigned depth)
+        : depth_{std::max(depth, 1u)}
+    {
+        if (const int error = io_uring_queue_init(depth_, &ring_, 0); error < 0) {
+            throw std::runtime_error{"failed to initialize io_uring: " +
+                                     std::system_category().message(-error)};
+        }
+
+        // Opening files requires Linux 5.6
+        io_uring_probe* const probe = io_uring_get_probe_ring(&ring_);
+        const bool supported = probe != nullptr && io_uring_opcode_supported(probe, IORING_OP_OPENAT) &&
+                               io_uring_opcode_supported(probe, IORING_OP_STATX);
+
+        if (probe != nullptr) {
+            io_uring_free_probe(probe);
+        }
+
+        if (!supported) {
+            io_uring_queue_exit(&ring_);
+            throw std::runtime_error{"io_uring cannot open files on this kernel"};
+        }
+
+        try {
+            blockingThread_ = std::thread{[this] {
+                runBlocking();
+            }};
+            thread_ = std::thread{[this] {
+                run();
+            }};
+        }
+        catch (...) {
+            stop();
+            throw;
+        }
+    }
+
+    ~UringReader() override
+    {
+        stop();
+    }
+
+    [[nodiscard]] std::future<FileBuffer> read(std::filesystem::path fileName) override
+    {
+        Request request{std::move(fileName), {}};
+        std::future<FileBuffer> result = request.promise.get_future();
+
+        {
+            std::scoped_lock lock{mutex_};
+            requests_.push_back(std::move(request));
+        }
+
+        requested_.notify_one();
+
+        return result;
+    }
+
+private:
+    // Operation a file waits for
+    enum class Step
+    {
+        open,
+        stat,
+        read
+    };
+
+    struct Operation
+    {
+        // Takes the request only once allocated such that it is left intact
+        // if the allocation fails
+        explicit Operation(Request&& request)
+            : request{std::move(request)}
+        {
+        }
+
+        ~Operation()
+        {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+
+        Operation(const Operation&) = delete;
+        Operation& operator=(const Operation&) = delete;
+
+        Request request;
+        Step step = Step::open;
+        int fd = -1;
+        struct statx status{};
+        std::shared_ptr<std::vector<char> > storage;
+        // Number of bytes read so far
+        std::size_t offset = 0;
+    };
+
+    // Waits for the files in flight and the helper thread before releasing
+    // the ring
+    void stop() noexcept
+    {
+        {
+            std::scoped_lock lock{mutex_};
+            stopping_ = true;
+        }
+
+        requested_.notify_one();
+
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+
+        // The ring thread no longer hands over any files
+        {
+            std::scoped_lock lock{mutex_};
+            blockingStopping_ = true;
+        }
+
+        blockingRequested_.notify_one();
+
+        if (blockingThread_.joinable()) {
+            blockingThread_.join();
+        }
+
+        io_uring_queue_exit(&ring_);
+    }
+
+    void run()
+    {
+        std::size_t inFlight = 0;
+
+        for (;;) {
+            std::vector<Request> started;
+
+            {
+                std::unique_lock lock{mutex_};
+
+                if (inFlight == 0) {
+                    requested_.wait(lock, [this] {
+                        return stopping_ || !requests_.empty();
+                    });
+
+                    if (requests_.empty()) {
+                        return;
+                    }
+                }
+
+                while (!requests_.empty() && inFlight + started.size() != depth_) {
+                    started.push_back(std::move(requests_.front()));
+                    requests_.pop_front();
+                }
+            }
+
+            for (Request& request : started) {
+                inFlight += start(std::move(request));
+            }
+
+            io_uring_submit(&ring_);
+
+            if (inFlight == 0) {
+                continue;
+            }
+
+            // Wake up regularly to submit new requests while operations are
+            // in flight
+            __kernel_timespec timeout{0, 1'000'000};
+            io_uring_cqe* cqe;
+
+            if (io_uring_wait_cqe_timeout(&ring_, &cqe, &timeout) != 0) {
+                continue;
+            }
+
+            do {
+                auto* operation = static_cast<Operation*>(io_uring_cqe_get_data(cqe));
+                const int result = cqe->res;
+                io_uring_cqe_seen(&ring_, cqe);
+
+                inFlight -= complete(operation, result);
+            } while (io_uring_peek_cqe(&ring_, &cqe) == 0);
+
+            io_uring_submit(&ring_);
+        }
+    }
+
+    // Reads the files handed over by the ring thread using blocking reads
+    void runBlocking()
+    {
+        for (;;) {
+            std::unique_ptr<Operation> operation;
+
+            {
+                std::unique_lock lock{mutex_};
+
+                blockingRequested_.wait(lock, [this] {
+                    return blockingStopping_ || !blocking_.empty();
+                });
+
+                if (blocking_.empty()) {
+                    return;
+                }
+
+                operation = std::move(blocking_.front());
+                blocking_.pop_front();
+            }
+
+            try {
+                operation->request.promise.set_value(readStream(operation->fd, operation->request.fileName));
+            }
+            catch (...) {
+                operation->request.promise.set_exception(std::current_exception());
+            }
+        }
+    }
+
+    // Reads the open file until its end
+    [[nodiscard]] static FileBuffer readStream(int fd, const std::filesystem::path& fileName)
+    {
+        auto storage = std::make_shared<std::vector<char> >();
+        std::size_t size = 0;
+
+        for (;;) {
+            if (size == storage->size()) {
+                storage->resize(std::max<std::size_t>(storage->size() * 2, 65536));
+            }
+
+            const ssize_t result = ::read(fd, storage->data() + size, storage->size() - size);
+
+            if (result < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                throw std::runtime_error{"failed to read " + fileName.string() + ": " +
+                                         std::system_category().message(errno)};
+            }
+
+            if (result == 0) {
+                break;
+            }
+
+            size += static_cast<std::size_t>(result);
+        }
+
+        storage->resize(size);
+
+        return FileBuffer::adopt(std::move(storage));
+    }
+
+    // Queues the opening of the file. Returns whether the file is in flight.
+    bool start(Request request)
+    {
+        Operation* operation;
+
+        try {
+            operation = new Operation{std::move(request)};
+        }
+        catch (...) {
+            request.promise.set_exception(std::current_exception());
+            return false;
+        }
+
+        submit(operation);
+
+        return true;
+    }
+
+    void submit(Operation* operation)
+    {
+        // At most depth operations are in flight, each with a single entry
+        io_uring_sqe* const sqe = io_uring_get_sqe(&ring_);
+
+        switch (operation->step) {
+            case Step::open:
+                io_uring_prep_openat(sqe, AT_FDCWD, operation->request.fileName.c_str(), O_RDONLY | O_CLOEXEC, 0);
+                break;
+            case Step::stat:
+                io_uring_prep_statx(sqe, operation->fd, "", AT_EMPTY_PATH, STATX_TYPE | STATX_SIZE,
+                                    &operation->status);
+                break;
+            case Step::read: {
+                std::vector<char>& storage = *operation->storage;
+
+                // Large files are read in chunks
+                const std::size_t size =
+                    std::min<std::size_t>(storage.size() - operation->offset, std::size_t{1} << 30);
+
+                io_uring_prep_read(sqe, operation->fd, storage.data() + operation->offset,
+                                   static_cast<unsigned>(size), operation->offset);
+                break;
+            }
+        }
+
+        io_uring_sqe_set_data(sqe, operation);
+    }
+
+    // Handles the completion of an operation and queues the next one of the
+    // file. Returns whether the file is done.
+    bool complete(Operation* operation, int result)
+    {
+        if (result == -EINTR || result == -EAGAIN) {
+            submit(operation);
+            return false;
+        }
+
+        const std::filesystem::path& fileName = operation->request.fileName;
+
+        try {
+            switch (operation->step) {
+                case Step::open:
+                    if (result < 0) {
+                        throw std::runtime_error{"failed to open " + fileName.string() + ": " +
+                                                 std::system_category().message(-result)};
+                    }
+
+                    operation->fd = result;
+                    operation->step = Step::stat;
+                    submit(operation);
+
+                    return false;
+                case Step::stat:
+                    if (result < 0 || !S_ISREG(operation->status.stx_mode) || operation->status.stx_size == 0) {
+                        // The size of pipes is not known in advance. Hand
+                        // over the open file to the helper thread.
+                        {
+                            std::scoped_lock lock{mutex_};
+                            blocking_.emplace_back(operation);
+                        }
+
+                        blockingRequested_.notify_one();
+
+                        return true;
+                    }
+
+                    operation->storage =
+                        std::make_shared<std::vector<char> >(static_cast<std::size_t>(operation->status.stx_size));
+                    operation->step = Step::read;
+                    submit(operation);
+
+                    return false;
+                case Step::read:
+                    if (result < 0) {
+                        throw std::runtime_error{"failed to read " + fileName.string() + ": " +
+                                                 std::system_category().message(-result)};
+                    }
+
+                    operation->offset += static_cast<std::size_t>(result);
+
+                    if (result > 0 && operation->offset != operation->storage->size()) {
+                        // Short read
+                        submit(operation);
+                        return false;
+                    }
+
+                    ::close(std::exchange(operation->fd, -1));
+
+                    // The file might have been truncated in the meantime
+                    operation->storage->resize(operation->offset);
+                    operation->request.promise.set_value(FileBuffer::adopt(std::move(operation->storage)));
+                    break;
+            }
+        }
+        catch (...) {
+            operation->request.promise.set_exception(std::current_exception());
+        }
+
+        delete operation;
+
+        return true;
+    }
+
+    unsigned depth_;
+    io_uring ring_;
+    std::mutex mutex_;
+    std::condition_variable requested_;
+    std::deque<Request> requests_;
+    bool stopping_ = false;
+    // Files of unknown size read by the helper thread
+    std::condition_variable blockingRequested_;
+    std::deque<std::unique_ptr<Operation> > blocking_;
+    bool blockingStopping_ = false;
+    std::thread thread_;
+    std::thread blockingThread_;
+};
+
+#endif // PAV1IET_HAVE_LIBURING
+
+} // namespace pav1iet
+
+#endif // PAV1IET_ASYNC_READER_HPP
@@ -0,0 +1,106 @@
+//
+// pav1iet - PASCAL Annotation Version 1.00 Extractor Tool
+// Copyright (C) 2026 Sergiu Deitsch <sergiu.deitsch@gmail.com>
+//
+// This file is part of pav1iet.
+//
+// pav1iet is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pav1iet is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pav1iet.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef PAV1IET_AUGMENT_HPP
+#define PAV1IET_AUGMENT_HPP
+
+#include <opencv2/core/core.hpp>
+
+#include <cmath>
+#include <cstddef>
+#include <random>
+
+#include <pav1iet/extractor.hpp>
+
+#include "random.hpp"
+
+namespace pav1iet {
+
+// Modification of the patch of an object applied in window coordinates
+struct Variant
+{
+    bool flip = false;
+    // Translation in window pixels
+    float dx = 0;
+    float dy = 0;
+    // Scale about the window center
+    float scale = 1;
+};
+
+// Number of variants extracted from each object
+[[nodiscard]] inline std::size_t numVariants(const Augmentation& augmentation) noexcept
+{
+    return (1 + augmentation.jitter) * (augmentation.flip ? 2 : 1);
+}
+
+// Appends the variants of a single object. The first variant is the original
+// patch, followed by its mirror image if enabled. Each jittered variant is
+// likewise followed by its mirror image.
+template<class Variants>
+void planVariants(const Augmentation& augmentation, std::mt19937_64& rng, Variants& variants)
+{
+    const double maxLogScale = std::log1p(augmentation.scale);
+
+    for (std::size_t i = 0; i != 1 + augmentation.jitter; ++i) {
+        Variant variant;
+
+        if (i != 0) {
+            variant.dx = static_cast<float>(uniform(rng, -augmentation.translation, augmentation.translation));
+            variant.dy = static_cast<float>(uniform(rng, -augmentation.translation, augmentation.translation));
+            variant.scale = static_cast<float>(std::exp(uniform(rng, -maxLogScale, maxLogScale)));
+        }
+
+        variants.push_back(variant);
+
+        if (augmentation.flip) {
+            variant.flip = true;
+            variants.push_back(variant);
+        }
+    }
+}
+
+// Composes the variant with the transformation M that maps the source image
+// onto the window such that each variant is extracted by a single warp
+[[nodiscard]] inline cv::Matx23f augmentTransform(const cv::Matx23f& M, const cv::Size& windowSize,
+                                                  const Variant& variant)
+{
+    // Center of the window in pixel coordinates
+    const float cx = static_cast<float>(windowSize.width - 1) / 2.0f;
+    const float cy = static_cast<float>(windowSize.height - 1) / 2.0f;
+    const float sx = variant.flip ? -variant.scale : variant.scale;
+    const float sy = variant.scale;
+
+    // x' = cx + sx (x - cx) + dx
+    const cv::Matx33f A{sx, 0, cx - sx * cx + variant.dx,
+                        0, sy, cy - sy * cy + variant.dy,
+                        0, 0, 1};
+    const cv::Matx33f B{M(0, 0), M(0, 1), M(0, 2),
+                        M(1, 0), M(1, 1), M(1, 2),
+                        0, 0, 1};
+    const cv::Matx33f C = A * B;
+
+    return cv::Matx23f{C(0, 0), C(0, 1), C(0, 2),
+                       C(1, 0), C(1, 1), C(1, 2)};
+}
+
+} // namespace pav1iet
+
+#endif // PAV1IET_AUGMENT_HPP
@@ -0,0 +1,97 @@
+//
+// pav1iet - PASCAL Annotation Version 1.00 Extractor Tool
+// Copyright (C) 2026 Sergiu Deitsch <sergiu.deitsch@gmail.com>
+//
+// This file is part of pav1iet.
+//
+// pav1iet is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pav1iet is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pav1iet.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef PAV1IET_BYTE_SIZE_HPP
+#define PAV1IET_BYTE_SIZE_HPP
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+namespace pav1iet {
+
+// Amount of memory or storage specified on the command line using an
+// optional binary suffix, e.g., 512M or 4G.
+struct ByteSize
+{
+    std::uintmax_t value = 0;
+};
+
+inline std::istream& operator>>(std::istream& in, ByteSize& size)
+{
+    std::uintmax_t value;
+
+    if (!(in >> value)) {
+        return in;
+    }
+
+    int shift = 0;
+
+    if (char suffix; in >> suffix) {
+        switch (suffix) {
+            case 'k':
+            case 'K':
+                shift = 10;
+                break;
+            case 'm':
+            case 'M':
+                shift = 20;
+                break;
+            case 'g':
+            case 'G':
+                shift = 30;
+                break;
+            case 't':
+            case 'T':
+                shift = 40;
+                break;
+            default:
+                in.setstate(std::ios_base::failbit);
+                return in;
+        }
+    }
+    else {
+        // A missing suffix is not an error
+        in.clear(in.rdstate() & ~std::ios_base::failbit);
+    }
+
+    size.value = value << shift;
+
+    return in;
+}
+
+inline std::ostream& operator<<(std::ostream& out, const ByteSize& size)
+{
+    constexpr char suffixes[] = {'T', 'G', 'M', 'K'};
+
+    for (int i = 0; i != 4; ++i) {
+        const int shift = (4 - i) * 10;
+
+        if (size.value != 0 && size.value % (std::uintmax_t{1} << shift) == 0) {
+            return out << (size.value >> shift) << suffixes[i];
+        }
+    }
+
+    return out << size.value;
+}
+
+} // namespace pav1iet
+
+#endif // PAV1IET_BYTE_SIZE_HPP
@@ -0,0 +1,177 @@
+//
+// pav1iet - PASCAL Annotation Version 1.00 Extractor Tool
+// Copyright (C) 2026 Sergiu Deitsch <sergiu.deitsch@gmail.com>
+//
+// This file is part of pav1iet.
+//
+// pav1iet is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pav1iet is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pav1iet.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef PAV1IET_CROP_HPP
+#define PAV1IET_CROP_HPP
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace pav1iet {
+
+// Image region mapped onto the detection window
+struct Crop
+{
+    cv::Point2f center;
+    // Size of the padded region in source image pixels
+    cv::Size size;
+};
+
+// Determines the region around the bounding box that has the aspect ratio of
+// the detection window and is padded such that the resized window contains
+// the specified padding on the left and the right. The vertical padding
+// follows from the aspect ratio.
+[[nodiscard]] inline Crop planCrop(const cv::Rect& rect, int imageHeight,
+                                   const cv::Size& windowSize, int padding)
+{
+    const int padding2 = padding * 2; // both sides
+    const cv::Point2f center = (rect.tl() + rect.br()) / 2.0f;
+
+    cv::Size size = rect.size();
+
+    cv::Size size1 = size;
+    size1.height = size.width * windowSize.height / windowSize.width;
+
+    cv::Size size2 = size;
+    size2.width = size.height * windowSize.width / windowSize.height;
+
+    assert(size1.width == 0 || size1.height / size1.width == windowSize.height / windowSize.width);
+    assert(size2.width == 0 || size2.height / size2.width == windowSize.height / windowSize.width);
+
+    // Compare ratios using integer arithmetic
+    // i/j > k/l <=> il > kj
+    const int ratio1 = size1.width * windowSize.height - size1.height * windowSize.width;
+
+    // Use the ratio-corrected image (with the larger area)
+    if (ratio1 < 0) {
+        assert(size1.area() >= size2.area());
+        size = size1;
+    }
+    else {
+        size = size2;
+    }
+
+    // Workout how much padding do we need to add to the original
+    // bounding box such that we obtain the desired padding in the
+    // resized image.
+    cv::Size extraPadding2;
+    extraPadding2.width = size.width * padding2 / windowSize.width;
+    extraPadding2.height = extraPadding2.width * windowSize.height / windowSize.width;
+
+    cv::Size newSize = size + extraPadding2;
+
+    int y = static_cast<int>(center.y);
+
+    int topOverflow = y - newSize.height / 2;
+    int bottomOverflow = imageHeight - (y + newSize.height / 2);
+
+    if (topOverflow < 0 || bottomOverflow < 0) {
+        // Cannot add sufficient vertical padding at the top/bottom
+        int paddingV = topOverflow < 0
+                           ? rect.y
+                           : imageHeight - (rect.y + rect.height);
+
+        newSize.height = size.height + paddingV * 2;
+        // Account for added vertical padding
+        newSize.width =
+            newSize.height * windowSize.width / windowSize.height;
+    }
+
+    return Crop{center, newSize};
+}
+
+// Factor by which the crop is shrunk when it is resized to the window size.
+// Values less than one denote upsampling.
+[[nodiscard]] inline float downsamplingFactor(const Crop& crop, const cv::Size& windowSize)
+{
+    return std::min(static_cast<float>(crop.size.width) / static_cast<float>(windowSize.width),
+                    static_cast<float>(crop.size.height) / static_cast<float>(windowSize.height));
+}
+
+// Largest power of two image reduction (up to 8 as supported by the image
+// decoders) that does not require any of the crops to be upsampled. The crops
+// may be additionally magnified by up to the given zoom.
+template<class Crops>
+[[nodiscard]] int decodeReduction(const Crops& crops, const cv::Size& windowSize, float zoom = 1)
+{
+    float factor = std::numeric_limits<float>::infinity();
+
+    for (const Crop& crop : crops) {
+        factor = std::min(factor, downsamplingFactor(crop, windowSize) / zoom);
+    }
+
+    int reduction = 1;
+
+    while (reduction < 8 && static_cast<float>(reduction * 2) <= factor) {
+        reduction *= 2;
+    }
+
+    return reduction;
+}
+
+// Affine transformation that maps the crop onto the window. The reduction
+// specifies the factor by which the source image was downscaled while
+// decoding. A reduced pixel i covers the full resolution pixels [ri, ri + r)
+// and its center is therefore located at ri + (r - 1) / 2.
+[[nodiscard]] inline cv::Matx23f cropTransform(const Crop& crop, const cv::Size& windowSize,
+                                               int reduction = 1)
+{
+    cv::Matx33f scale = cv::Matx33f::eye();
+    scale(0, 0) = static_cast<float>(windowSize.width) /
+                  static_cast<float>(crop.size.width);
+    scale(1, 1) = static_cast<float>(windowSize.height) /
+                  static_cast<float>(crop.size.height);
+
+    cv::Matx33f translate = cv::Matx33f::eye();
+    translate(0, 2) = -(crop.center.x - static_cast<float>(crop.size.width) / 2.0f);
+    translate(1, 2) = -(crop.center.y - static_cast<float>(crop.size.height) / 2.0f);
+
+    cv::Matx33f tmp = scale * translate;
+
+    if (reduction > 1) {
+        const auto r = static_cast<float>(reduction);
+        const float offset = (r - 1.0f) / 2.0f;
+
+        tmp = tmp * cv::Matx33f{r, 0, offset,
+                                0, r, offset,
+                                0, 0, 1};
+    }
+
+    // Take the two top rows.
+    return cv::Matx23f{tmp(0, 0), tmp(0, 1), tmp(0, 2),
+                       tmp(1, 0), tmp(1, 1), tmp(1, 2)};
+}
+
+[[nodiscard]] inline cv::InterpolationFlags cropInterpolation(const Crop& crop, const cv::Size& windowSize,
+                                                             int reduction = 1)
+{
+    // In case we are downsampling, avoid antialiasing.
+    return crop.size.area() > windowSize.area() * reduction * reduction
+        ? cv::INTER_AREA
+        : cv::INTER_CUBIC;
+}
+
+} // namespace pav1iet
+
+#endif // PAV1IET_CROP_HPP
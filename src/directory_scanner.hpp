@@ -0,0 +1,204 @@
+//
+// pav1iet - PASCAL Annotation Version 1.00 Extractor Tool
+// Copyright (C) 2026 Sergiu Deitsch <sergiu.deitsch@gmail.com>
+//
+// This file is part of pav1iet.
+//
+// pav1iet is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pav1iet is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pav1iet.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef PAV1IET_DIRECTORY_SCANNER_HPP
+#define PAV1IET_DIRECTORY_SCANNER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <tbb/concurrent_vector.h>
+#include <tbb/parallel_for_each.h>
+#include <tbb/parallel_sort.h>
+
+namespace pav1iet {
+
+// Matches a file name against a glob supporting * and ? wildcards
+[[nodiscard]] inline bool matchesGlob(std::string_view pattern, std::string_view name) noexcept
+{
+    std::size_t p = 0;
+    std::size_t n = 0;
+    // Position after the last * and the name position it was matched up to
+    std::size_t star = std::string_view::npos;
+    std::size_t resume = 0;
+
+    while (n != name.size()) {
+        // A * is always a wildcard, even if the name contains a * as well
+        if (p != pattern.size() && pattern[p] == '*') {
+            star = ++p;
+            resume = n;
+        }
+        else if (p != pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+            ++p;
+            ++n;
+        }
+        else if (star != std::string_view::npos) {
+            // Let the last * consume one more character
+            p = star;
+            n = ++resume;
+        }
+        else {
+            return false;
+        }
+    }
+
+    while (p != pattern.size() && pattern[p] == '*') {
+        ++p;
+    }
+
+    return p == pattern.size();
+}
+
+// Recursively traverses directories in the background and hands out the
+// files whose names match a glob. Directories are listed in parallel and
+// files are handed out as soon as they are discovered unless they need to be
+// sorted, in which case the traversal has to finish first. Symbolic links to
+// directories are not followed.
+class DirectoryScanner
+{
+public:
+    DirectoryScanner(std::vector<std::filesystem::path> directories, std::string pattern, bool sorted)
+        : pattern_{std::move(pattern)}
+        , sorted_{sorted}
+    {
+        thread_ = std::thread{[this, directories = std::move(directories)] {
+            try {
+                scan(directories);
+            }
+            catch (...) {
+                std::scoped_lock lock{mutex_};
+                error_ = std::current_exception();
+            }
+
+            {
+                std::scoped_lock lock{mutex_};
+                done_ = true;
+            }
+
+            available_.notify_all();
+        }};
+    }
+
+    DirectoryScanner(const DirectoryScanner&) = delete;
+    DirectoryScanner& operator=(const DirectoryScanner&) = delete;
+
+    ~DirectoryScanner()
+    {
+        cancelled_.store(true, std::memory_order_relaxed);
+        thread_.join();
+    }
+
+    // Blocks until the next file is discovered. Returns false once all the
+    // files have been handed out and rethrows the traversal error if any.
+    [[nodiscard]] bool next(std::filesystem::path& fileName)
+    {
+        std::unique_lock lock{mutex_};
+
+        available_.wait(lock, [this] {
+            return !files_.empty() || done_;
+        });
+
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+
+        if (files_.empty()) {
+            return false;
+        }
+
+        fileName = std::move(files_.front());
+        files_.pop_front();
+
+        return true;
+    }
+
+private:
+    void scan(const std::vector<std::filesystem::path>& directories)
+    {
+        tbb::concurrent_vector<std::filesystem::path> found;
+
+        tbb::parallel_for_each(directories.begin(), directories.end(),
+            [this, &found] (const std::filesystem::path& directory,
+                            tbb::feeder<std::filesystem::path>& feeder) {
+                if (cancelled_.load(std::memory_order_relaxed)) {
+                    return;
+                }
+
+                std::vector<std::filesystem::path> files;
+
+                for (const auto& entry : std::filesystem::directory_iterator{directory}) {
+                    if (entry.is_directory() && !entry.is_symlink()) {
+                        feeder.add(entry.path());
+                    }
+                    else if (entry.is_regular_file() &&
+                             matchesGlob(pattern_, entry.path().filename().string())) {
+                        files.push_back(entry.path());
+                    }
+                }
+
+                if (sorted_) {
+                    found.grow_by(files.begin(), files.end());
+                }
+                else if (!files.empty()) {
+                    publish(files.begin(), files.end());
+                }
+            });
+
+        if (sorted_) {
+            tbb::parallel_sort(found.begin(), found.end());
+            publish(found.begin(), found.end());
+        }
+    }
+
+    template<class Iterator>
+    void publish(Iterator first, Iterator last)
+    {
+        {
+            std::scoped_lock lock{mutex_};
+            files_.insert(files_.end(), std::make_move_iterator(first), std::make_move_iterator(last));
+        }
+
+        available_.notify_one();
+    }
+
+    std::string pattern_;
+    bool sorted_;
+    std::atomic_bool cancelled_{false};
+    std::mutex mutex_;
+    std::condition_variable available_;
+    std::deque<std::filesystem::path> files_;
+    bool done_ = false;
+    std::exception_ptr error_;
+    std::thread thread_;
+};
+
+} // namespace pav1iet
+
+#endif // PAV1IET_DIRECTORY_SCANNER_HPP
@@ -0,0 +1,1972 @@
+//
+// pav1iet - PASCAL Annotation Version 1.00 Extractor Tool
+// Copyright (C) 2026 Sergiu Deitsch <sergiu.deitsch@gmail.com>
+//
+// This file is part of pav1iet.
+//
+// pav1iet is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pav1iet is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pav1iet.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <opencv2/imgcodecs/imgcodecs.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <istream>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <ostream>
+#include <random>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// Enable for debugging purposes
+// #define BOOST_SPIRIT_X3_DEBUG
+#define BOOST_SPIRIT_X3_UNICODE
+
+#include <boost/fusion/adapted/std_tuple.hpp>
+#include <boost/scope_exit.hpp>
+#include <boost/spirit/home/support/iterators/istream_iterator.hpp>
+#include <boost/spirit/home/x3.hpp>
+#include <boost/spirit/home/x3/support/utility/utf8.hpp>
+
+#include <tbb/blocked_range.h>
+#include <tbb/concurrent_queue.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/global_control.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_pipeline.h>
+#include <tbb/task_arena.h>
+
+#include <pav1iet/extractor.hpp>
+
+#include "arena.hpp"
+#include "async_reader.hpp"
+#include "augment.hpp"
+#include "crop.hpp"
+#include "directory_scanner.hpp"
+#include "fast_parser.hpp"
+#include "file_buffer.hpp"
+#include "grammar.hpp"
+#include "hash.hpp"
+#include "image_cache.hpp"
+#include "manifest.hpp"
+#include "memory_budget.hpp"
+#include "negatives.hpp"
+#include "patch_pool.hpp"
+#include "random.hpp"
+#include "read_limiter.hpp"
+#include "resample.hpp"
+#include "tar_archive.hpp"
+#include "trace.hpp"
+
+namespace pav1iet {
+
+std::istream& operator>>(std::istream& in, AnnotationInput& value)
+{
+    std::string token;
+    in >> token;
+
+    if (token == "stream") {
+        value = AnnotationInput::stream;
+    }
+    else if (token == "read") {
+        value = AnnotationInput::read;
+    }
+    else if (token == "mmap") {
+        value = AnnotationInput::map;
+    }
+    else {
+        in.setstate(std::ios_base::failbit);
+    }
+
+    return in;
+}
+
+std::ostream& operator<<(std::ostream& out, AnnotationInput value)
+{
+    switch (value) {
+        case AnnotationInput::stream:
+            return out << "stream";
+        case AnnotationInput::read:
+            return out << "read";
+        case AnnotationInput::map:
+            return out << "mmap";
+    }
+
+    return out;
+}
+
+std::istream& operator>>(std::istream& in, CropKernel& value)
+{
+    std::string token;
+    in >> token;
+
+    if (token == "warp") {
+        value = CropKernel::warp;
+    }
+    else if (token == "separable") {
+        value = CropKernel::separable;
+    }
+    else {
+        in.setstate(std::ios_base::failbit);
+    }
+
+    return in;
+}
+
+std::ostream& operator<<(std::ostream& out, CropKernel value)
+{
+    switch (value) {
+        case CropKernel::warp:
+            return out << "warp";
+        case CropKernel::separable:
+            return out << "separable";
+    }
+
+    return out;
+}
+
+std::istream& operator>>(std::istream& in, IoEngine& value)
+{
+    std::string token;
+    in >> token;
+
+    if (token == "sync") {
+        value = IoEngine::sync;
+    }
+    else if (token == "threads") {
+        value = IoEngine::threads;
+    }
+    else if (token == "uring") {
+        value = IoEngine::uring;
+    }
+    else {
+        in.setstate(std::ios_base::failbit);
+    }
+
+    return in;
+}
+
+std::ostream& operator<<(std::ostream& out, IoEngine value)
+{
+    switch (value) {
+        case IoEngine::sync:
+            return out << "sync";
+        case IoEngine::threads:
+            return out << "threads";
+        case IoEngine::uring:
+            return out << "uring";
+    }
+
+    return out;
+}
+
+std::istream& operator>>(std::istream& in, PixelFormat& value)
+{
+    std::string token;
+    in >> token;
+
+    if (token == "bgr8") {
+        value = PixelFormat::bgr8;
+    }
+    else if (token == "gray8") {
+        value = PixelFormat::gray8;
+    }
+    else if (token == "gray32f") {
+        value = PixelFormat::gray32f;
+    }
+    else if (token == "bgr32f") {
+        value = PixelFormat::bgr32f;
+    }
+    else {
+        in.setstate(std::ios_base::failbit);
+    }
+
+    return in;
+}
+
+std::ostream& operator<<(std::ostream& out, PixelFormat value)
+{
+    switch (value) {
+        case PixelFormat::bgr8:
+            return out << "bgr8";
+        case PixelFormat::gray8:
+            return out << "gray8";
+        case PixelFormat::gray32f:
+            return out << "gray32f";
+        case PixelFormat::bgr32f:
+            return out << "bgr32f";
+    }
+
+    return out;
+}
+
+int patchType(PixelFormat format) noexcept
+{
+    switch (format) {
+        case PixelFormat::gray8:
+            return CV_8UC1;
+        case PixelFormat::gray32f:
+            return CV_32FC1;
+        case PixelFormat::bgr32f:
+            return CV_32FC3;
+        case PixelFormat::bgr8:
+            break;
+    }
+
+    return CV_8UC3;
+}
+
+std::istream& operator>>(std::istream& in, AnnotationParser& value)
+{
+    std::string token;
+    in >> token;
+
+    if (token == "x3") {
+        value = AnnotationParser::x3;
+    }
+    else if (token == "fast") {
+        value = AnnotationParser::fast;
+    }
+    else {
+        in.setstate(std::ios_base::failbit);
+    }
+
+    return in;
+}
+
+std::ostream& operator<<(std::ostream& out, AnnotationParser value)
+{
+    switch (value) {
+        case AnnotationParser::x3:
+            return out << "x3";
+        case AnnotationParser::fast:
+            return out << "fast";
+    }
+
+    return out;
+}
+
+namespace {
+
+// Pipeline stages in the order they process an item. The annotation files
+// are planned before they enter the pipeline if the images are scheduled by
+// their cost.
+enum class Stage : std::size_t
+{
+    planFiles,
+    readFileName,
+    loadAnnotations,
+    numberPatches,
+    admitImages,
+    loadImages,
+    processObjects,
+    consumePatches
+};
+
+const std::vector<std::string> StageNames{
+    "planFiles", "readFileName", "loadAnnotations", "numberPatches", "admitImages", "loadImages", "processObjects",
+    "consumePatches"};
+
+// Patches of an image extracted by a single task. Images with fewer patches
+// are processed without spawning tasks.
+constexpr std::size_t PatchesPerTask = 4;
+
+// Crops in full resolution image coordinates for each window
+using CropPlan = std::pmr::vector<std::pmr::vector<Crop> >;
+
+// Assigns the output indices in listing order. The patches of the objects
+// are numbered consecutively across all the files while the negative windows
+// of each window are numbered separately.
+class OutputNumbering
+{
+public:
+    explicit OutputNumbering(std::size_t numWindows)
+        : numNegativesAssigned_(numWindows)
+    {
+    }
+
+    // Returns the output index of the first of the given number of patches
+    [[nodiscard]] std::size_t assign(std::size_t count) noexcept
+    {
+        return std::exchange(numAssigned_, numAssigned_ + count);
+    }
+
+    // Returns the output index of the first of the given number of negative
+    // windows of the window
+    [[nodiscard]] std::size_t assignNegatives(std::size_t window, std::size_t count) noexcept
+    {
+        return std::exchange(numNegativesAssigned_[window], numNegativesAssigned_[window] + count);
+    }
+
+    // One past the last output index assigned to a patch of an object
+    [[nodiscard]] std::size_t end() const noexcept
+    {
+        return numAssigned_;
+    }
+
+private:
+    std::size_t numAssigned_ = 0;
+    std::vector<std::size_t> numNegativesAssigned_;
+};
+
+// Annotation file whose output indices were assigned by the planning pass
+struct PlannedFile
+{
+    std::filesystem::path fileName;
+    // Parsed annotations handed to the pipeline instead of parsing the file
+    // again. Allocated from an arena that lives as long as the plan.
+    std::optional<pascal_v1::ast::pmr::Annotations> annotations;
+    // Output index of the first patch and the number of patches
+    std::size_t firstIndex = 0;
+    std::size_t count = 0;
+    // Number of negative windows and the output index of the first one of
+    // each window
+    std::vector<std::size_t> numNegatives;
+    std::vector<std::size_t> firstNegativeIndex;
+    // Estimated work of processing the image in bytes of pixels touched
+    std::uintmax_t cost = 0;
+};
+
+// Unit of work passed between the pipeline stages
+struct Item
+{
+    Item() = default;
+
+    // Allocates the annotations, the crops and the patch lists from the arena
+    explicit Item(ArenaPool::Handle handle)
+        : arena{std::move(handle)}
+        , annotations{arena.get()}
+        , crops{arena.get()}
+        , negatives{arena.get()}
+        , variants{arena.get()}
+        , firstNegativeIndex{arena.get()}
+        , patches{arena.get()}
+    {
+    }
+
+    // Declared first such that the arena is recycled only after the members
+    // allocated from it have been destroyed
+    ArenaPool::Handle arena;
+    // Memory budget of the image and the patches
+    MemoryBudget::Reservation reservation;
+    std::filesystem::path fileName;
+    pascal_v1::ast::pmr::Annotations annotations;
+    // Output index of the first patch
+    std::size_t firstIndex = 0;
+    cv::Mat image;
+    // Keeps the pixels of a cached image alive
+    ImageCache::Handle imageOwner;
+    // Factor by which the image was downscaled during decoding
+    int reduction = 1;
+    CropPlan crops;
+    // Negative windows sampled from the background
+    CropPlan negatives;
+    // Variants of the objects of each window
+    std::pmr::vector<std::pmr::vector<Variant> > variants;
+    // Output index of the first negative window of each window
+    std::pmr::vector<std::size_t> firstNegativeIndex;
+    // Patches for each window: the variants of the objects followed by the
+    // negative windows
+    std::pmr::vector<std::pmr::vector<cv::Mat> > patches;
+    // Manifest entry of the annotation file
+    ManifestEntry record;
+    // Whether the patches of a previous run are up to date
+    bool unchanged = false;
+    // Whether the hash of the image is computed from the buffer it is decoded
+    // from
+    bool hashImage = false;
+    // Output indices assigned in advance if the images are scheduled by
+    // their cost
+    const PlannedFile* plan = nullptr;
+    // Reads started ahead of the pipeline by the asynchronous I/O engine
+    std::future<FileBuffer> annotationRead;
+    std::future<FileBuffer> imageRead;
+    // Time the previous stage finished processing the item if tracing
+    PipelineTrace::Clock::time_point handoff;
+};
+
+void planCrops(const pascal_v1::ast::pmr::Annotations& annotations, int imageHeight,
+               const std::vector<Window>& windows, CropPlan& crops)
+{
+    crops.resize(windows.size());
+
+    for (std::size_t i = 0; i != windows.size(); ++i) {
+        crops[i].clear();
+        crops[i].reserve(annotations.objects.size());
+
+        for (const auto& object : annotations.objects) {
+            crops[i].push_back(planCrop(object.boundingBox, imageHeight,
+                                        windows[i].windowSize, windows[i].padding));
+        }
+    }
+}
+
+// Whether the image can be decoded as a single channel because either the
+// patches or the image itself are grayscale
+[[nodiscard]] bool decodeGrayscale(const pascal_v1::ast::pmr::Annotations& annotations, PixelFormat format)
+{
+    return CV_MAT_CN(patchType(format)) == 1 || annotations.channels == 1;
+}
+
+// Memory of the decoded image estimated from the annotated image size
+[[nodiscard]] std::uintmax_t imageMemory(const pascal_v1::ast::pmr::Annotations& annotations, PixelFormat format)
+{
+    const cv::Size& size = annotations.imageSize;
+
+    if (size.width <= 0 || size.height <= 0) {
+        return 0;
+    }
+
+    return static_cast<std::uintmax_t>(size.width) * static_cast<std::uintmax_t>(size.height) *
+           (decodeGrayscale(annotations, format) ? 1u : 3u);
+}
+
+// Memory of the patches extracted from the objects of an image
+[[nodiscard]] std::uintmax_t patchMemory(std::size_t numObjects, const std::vector<Window>& windows,
+                                         PixelFormat format)
+{
+    std::uintmax_t bytes = 0;
+
+    for (const Window& window : windows) {
+        bytes += static_cast<std::uintmax_t>(window.windowSize.area()) * CV_ELEM_SIZE(patchType(format));
+    }
+
+    return bytes * numObjects;
+}
+
+// Samples the negative windows using the annotated image size
+void planNegatives(const pascal_v1::ast::pmr::Annotations& annotations, const ExtractorOptions& options,
+                   CropPlan& negatives)
+{
+    negatives.resize(options.windows.size());
+
+    if (options.negatives.count == 0) {
+        return;
+    }
+
+    for (std::size_t i = 0; i != options.windows.size(); ++i) {
+        std::mt19937_64 rng = makeGenerator(options.seed, std::string_view{annotations.imageFileName}, i);
+        sampleNegatives(annotations.imageSize, annotations.objects, options.windows[i].windowSize,
+                        options.negatives.count, options.negatives.maxOverlap, rng, negatives[i]);
+    }
+}
+
+// The reduction must satisfy the window with the finest resolution. Objects
+// are magnified by up to the scale jitter.
+[[nodiscard]] int decodeReduction(const CropPlan& crops, const CropPlan& negatives,
+                                  const std::vector<Window>& windows, const Augmentation& augmentation)
+{
+    int reduction = 8;
+    const auto zoom = static_cast<float>(augmentation.jitter != 0 ? 1 + augmentation.scale : 1);
+
+    for (std::size_t i = 0; i != windows.size(); ++i) {
+        reduction = std::min(reduction, pav1iet::decodeReduction(crops[i], windows[i].windowSize, zoom));
+        reduction = std::min(reduction, pav1iet::decodeReduction(negatives[i], windows[i].windowSize));
+    }
+
+    return reduction;
+}
+
+// Hash of the options that affect the contents of the patches
+[[nodiscard]] std::uint64_t parametersHash(const ExtractorOptions& options)
+{
+    Fnv1a hash;
+
+    for (const Window& window : options.windows) {
+        hash.update(window.windowSize.width)
+            .update(window.windowSize.height)
+            .update(window.padding);
+    }
+
+    hash.update(options.augmentation.flip)
+        .update(options.augmentation.jitter)
+        .update(&options.augmentation.translation, sizeof options.augmentation.translation)
+        .update(&options.augmentation.scale, sizeof options.augmentation.scale)
+        .update(options.seed);
+
+    hash.update(static_cast<int>(options.pixelFormat))
+        .update(options.normalization.has_value());
+
+    if (options.normalization) {
+        hash.update(&options.normalization->mean, sizeof options.normalization->mean)
+            .update(&options.normalization->std, sizeof options.normalization->std);
+    }
+
+    hash.update(options.reducedDecode)
+        .update(static_cast<int>(options.cropKernel))
+        .update(options.consumerParametersHash);
+
+    return hash.value();
+}
+
+// Determines the inputs of an annotation file for the manifest. The image is
+// hashed up front only if the annotation file did not change but the size or
+// the modification time of the image did, since only then the hash decides
+// whether the file can be skipped. Otherwise, the hash of the previous run is
+// kept or, if the annotation file changed, the image hash is left to be
+// computed while the image is decoded.
+[[nodiscard]] ManifestEntry describeInputs(const std::filesystem::path& annotationFileName,
+                                           const std::filesystem::path& imageFileName,
+                                           const ManifestEntry* previous,
+                                           const ReadLimiter& limitRead)
+{
+    ManifestEntry entry;
+
+    entry.annotationHash = limitRead([&annotationFileName] {
+        return hashFileContents(annotationFileName);
+    });
+
+    std::error_code ec;
+    entry.imageSize = std::filesystem::file_size(imageFileName, ec);
+
+    if (ec) {
+        throw std::invalid_argument{"failed to read image " + imageFileName.string()};
+    }
+
+    entry.imageTime = std::filesystem::last_write_time(imageFileName).time_since_epoch().count();
+
+    if (previous == nullptr || previous->annotationHash != entry.annotationHash) {
+        return entry;
+    }
+
+    if (previous->imageSize == entry.imageSize && previous->imageTime == entry.imageTime) {
+        entry.imageHash = previous->imageHash;
+    }
+    else {
+        entry.imageHash = limitRead([&imageFileName] {
+            return hashFileContents(imageFileName);
+        });
+    }
+
+    return entry;
+}
+
+[[nodiscard]] int reducedImreadMode(int reduction, bool grayscale)
+{
+    switch (reduction) {
+        case 2:
+            return grayscale ? cv::IMREAD_REDUCED_GRAYSCALE_2 : cv::IMREAD_REDUCED_COLOR_2;
+        case 4:
+            return grayscale ? cv::IMREAD_REDUCED_GRAYSCALE_4 : cv::IMREAD_REDUCED_COLOR_4;
+        case 8:
+            return grayscale ? cv::IMREAD_REDUCED_GRAYSCALE_8 : cv::IMREAD_REDUCED_COLOR_8;
+        default:
+            assert(reduction == 1);
+            return grayscale ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR;
+    }
+}
+
+// Maps the decoded 8-bit pixels to the pixel format of the patches
+struct PixelConversion
+{
+    // Type of the patches
+    int type = CV_8UC3;
+    // Each channel c is converted to value * alpha[c] + beta[c]
+    cv::Scalar alpha = cv::Scalar::all(1);
+    cv::Scalar beta = cv::Scalar::all(0);
+};
+
+[[nodiscard]] PixelConversion makeConversion(PixelFormat format, const std::optional<Normalization>& normalization)
+{
+    PixelConversion conversion;
+    conversion.type = patchType(format);
+
+    if (CV_MAT_DEPTH(conversion.type) == CV_32F) {
+        const Normalization n = normalization.value_or(Normalization{});
+
+        for (int c = 0; c != 4; ++c) {
+            conversion.alpha[c] = 1.0 / (255.0 * n.std[c]);
+            conversion.beta[c] = -n.mean[c] / n.std[c];
+        }
+    }
+
+    return conversion;
+}
+
+// Stores the 8-bit values v of channel c as v * alpha[c] + beta[c] using the
+// destination depth U. A single channel is replicated if the patches have
+// three.
+template<class U>
+void convertPixels(const cv::Mat& src, cv::Mat& dst, const PixelConversion& conversion)
+{
+    const int cnIn = src.channels();
+    const int cnOut = dst.channels();
+    const int rowLength = dst.cols * cnOut;
+
+    // Conversion coefficients of each row element
+    std::vector<float> scale(static_cast<std::size_t>(rowLength));
+    std::vector<float> offset(static_cast<std::size_t>(rowLength));
+
+    for (int j = 0; j != rowLength; ++j) {
+        scale[j] = static_cast<float>(conversion.alpha[j % cnOut]);
+        offset[j] = static_cast<float>(conversion.beta[j % cnOut]);
+    }
+
+    for (int y = 0; y != src.rows; ++y) {
+        const uchar* const in = src.ptr<uchar>(y);
+        U* const out = dst.ptr<U>(y);
+
+        if (cnIn == cnOut) {
+            for (int j = 0; j != rowLength; ++j) {
+                out[j] = cv::saturate_cast<U>(static_cast<float>(in[j]) * scale[j] + offset[j]);
+            }
+        }
+        else {
+            for (int j = 0; j != rowLength; ++j) {
+                out[j] = cv::saturate_cast<U>(static_cast<float>(in[j / cnOut]) * scale[j] + offset[j]);
+            }
+        }
+    }
+}
+
+// Converts a resampled 8-bit patch to the pixel format of the patches
+void convertPixels(const cv::Mat& src, cv::Mat& dst, const PixelConversion& conversion)
+{
+    dst.create(src.size(), conversion.type);
+
+    if (dst.depth() == CV_32F) {
+        convertPixels<float>(src, dst, conversion);
+    }
+    else {
+        convertPixels<uchar>(src, dst, conversion);
+    }
+}
+
+// Resamples the crop of the image into the patch and converts it to the
+// pixel format of the patches
+void extractPatch(const cv::Mat& image, cv::Mat& patch, const cv::Matx23f& M, const cv::Size& windowSize,
+                  cv::InterpolationFlags flags, CropKernel kernel, const std::optional<double>& tolerance,
+                  const PixelConversion& conversion)
+{
+    const bool separable = kernel == CropKernel::separable && isAxisAligned(M);
+
+    if (image.type() == conversion.type) {
+        if (separable) {
+            resampleAxisAligned(image, patch, M, windowSize, flags);
+        }
+        else {
+            cv::warpAffine(image, patch, M, windowSize, flags, cv::BORDER_REFLECT);
+        }
+    }
+    else if (separable && image.channels() == CV_MAT_CN(conversion.type)) {
+        // The resampled values are converted before being stored
+        resampleAxisAligned(image, patch, M, windowSize, flags, CV_MAT_DEPTH(conversion.type), conversion.alpha,
+                            conversion.beta);
+    }
+    else {
+        // Only the pixels of the small patch are converted while they are
+        // still in the cache
+        thread_local cv::Mat resampled;
+
+        if (separable) {
+            resampleAxisAligned(image, resampled, M, windowSize, flags);
+        }
+        else {
+            cv::warpAffine(image, resampled, M, windowSize, flags, cv::BORDER_REFLECT);
+        }
+
+        convertPixels(resampled, patch, conversion);
+    }
+
+    if (tolerance) {
+        cv::Mat expected;
+        cv::Mat actual;
+
+        cv::warpAffine(image, expected, M, windowSize, flags, cv::BORDER_REFLECT);
+
+        if (isAxisAligned(M)) {
+            resampleAxisAligned(image, actual, M, windowSize, flags);
+        }
+
+        if (!actual.empty()) {
+            const double difference = cv::norm(expected, actual, cv::NORM_INF);
+
+            if (difference > *tolerance) {
+                throw std::runtime_error{std::format(
+                    "separable crop kernel deviates from cv::warpAffine by {} (tolerance {})",
+                    difference, *tolerance)};
+            }
+        }
+    }
+}
+
+// Decoders round the reduced dimensions either up (JPEG) or down.
+[[nodiscard]] bool matchesReducedSize(const cv::Size& reduced, const cv::Size& full, int reduction)
+{
+    const auto matches = [reduction] (int r, int f) {
+        return r == f / reduction || r == (f + reduction - 1) / reduction;
+    };
+
+    return matches(reduced.width, full.width) && matches(reduced.height, full.height);
+}
+
+template<class Iterator>
+[[nodiscard]] bool parseAnnotations(Iterator first, Iterator last, pascal_v1::ast::Annotations& annotations)
+{
+    namespace x3 = boost::spirit::x3;
+
+    // clang-format off
+    return x3::phrase_parse
+    (
+          first
+        , last
+        , pascal_v1::annotation >> x3::eoi
+        , x3::unicode::space
+        , annotations
+    );
+    // clang-format on
+}
+
+// Parses the annotations in a contiguous buffer. If verification is enabled,
+// the result of the other parser must match.
+[[nodiscard]] bool parseAnnotations(const FileBuffer& buffer, AnnotationParser parser, bool verify,
+                                    const std::filesystem::path& fileName,
+                                    pascal_v1::ast::pmr::Annotations& annotations)
+{
+    if (parser == AnnotationParser::fast && !verify) {
+        // Strings and containers are allocated directly from the arena
+        return pascal_v1::fast::parse(buffer.view(), annotations);
+    }
+
+    const auto parse = [&buffer] (AnnotationParser parser, pascal_v1::ast::Annotations& annotations) {
+        if (parser == AnnotationParser::fast) {
+            return pascal_v1::fast::parse(buffer.view(), annotations);
+        }
+
+        return parseAnnotations(buffer.begin(), buffer.end(), annotations);
+    };
+
+    // The grammar synthesizes its own attribute which is copied afterwards
+    pascal_v1::ast::Annotations result;
+    const bool parsed = parse(parser, result);
+
+    if (verify) {
+        pascal_v1::ast::Annotations expected;
+        const bool expectedParsed =
+            parse(parser == AnnotationParser::fast ? AnnotationParser::x3 : AnnotationParser::fast, expected);
+
+        if (parsed != expectedParsed || (parsed && result != expected)) {
+            throw std::runtime_error{"the annotation parsers disagree on " + fileName.string()};
+        }
+    }
+
+    if (parsed) {
+        annotations.assign(result);
+    }
+
+    return parsed;
+}
+
+// Blocks until the read started in the background completes
+[[nodiscard]] FileBuffer awaitRead(std::future<FileBuffer>& read, PipelineTrace* trace)
+{
+    const PipelineTrace::Clock::time_point begin = PipelineTrace::Clock::now();
+    FileBuffer buffer = read.get();
+
+    if (trace != nullptr) {
+        trace->ioWait(PipelineTrace::Clock::now() - begin);
+        trace->read(buffer.size());
+    }
+
+    return buffer;
+}
+
+// Parses the annotation file from the archive if given or the file system
+void loadAnnotationFile(const std::filesystem::path& fileName, const ExtractorOptions& options,
+                        const ReadLimiter& limitRead, const TarArchive* archive, PipelineTrace* trace,
+                        pascal_v1::ast::pmr::Annotations& annotations)
+{
+    bool parsed;
+
+    if (archive != nullptr) {
+        const FileBuffer buffer = archive->open(fileName);
+        parsed = parseAnnotations(buffer, options.annotationParser, options.verifyParser, fileName, annotations);
+
+        if (trace != nullptr) {
+            trace->read(buffer.size());
+        }
+    }
+    else if (options.annotationInput == AnnotationInput::stream) {
+        // Parsing interleaves with reading
+        parsed = limitRead([&fileName, &annotations] {
+            std::ifstream in{fileName};
+            in.unsetf(std::ios_base::skipws);
+
+            pascal_v1::ast::Annotations result;
+
+            if (!parseAnnotations(boost::spirit::istream_iterator{in}, boost::spirit::istream_iterator{}, result)) {
+                return false;
+            }
+
+            annotations.assign(result);
+            return true;
+        });
+    }
+    else if (options.annotationInput == AnnotationInput::map) {
+        // Contiguous buffers allow the grammar to backtrack using plain
+        // pointers instead of buffering the input in a multi-pass iterator.
+        // Pages are faulted in while parsing which therefore counts as
+        // reading.
+        parsed = limitRead([&fileName, &options, &annotations] {
+            const FileBuffer buffer = FileBuffer::map(fileName);
+            return parseAnnotations(buffer, options.annotationParser, options.verifyParser, fileName, annotations);
+        });
+    }
+    else {
+        // Reading interleaves with parsing for the other inputs and is
+        // therefore not accounted for as blocking.
+        const PipelineTrace::Clock::time_point begin = PipelineTrace::Clock::now();
+        const FileBuffer buffer = limitRead([&fileName] {
+            return FileBuffer::read(fileName);
+        });
+
+        if (trace != nullptr) {
+            trace->ioWait(PipelineTrace::Clock::now() - begin);
+        }
+
+        parsed = parseAnnotations(buffer, options.annotationParser, options.verifyParser, fileName, annotations);
+    }
+
+    if (!parsed) {
+        throw std::runtime_error{"failed to parse annotations in " + fileName.string()};
+    }
+
+    if (archive == nullptr && trace != nullptr) {
+        std::error_code ec;
+        trace->read(std::filesystem::file_size(fileName, ec));
+    }
+}
+
+// Parses all the annotation files up front to estimate the cost of their
+// images. The annotations are kept for the pipeline such that each file is
+// read and parsed only once. An asynchronous reader reads the files in
+// batches of the read-ahead. The output indices are assigned in listing
+// order such that the order the files are processed in does not affect the
+// output.
+[[nodiscard]] std::vector<PlannedFile> planFiles(const std::function<bool(std::filesystem::path&)>& nextFile,
+                                                 const ExtractorOptions& options, const ReadLimiter& limitRead,
+                                                 const TarArchive* archive, AsyncReader* reader,
+                                                 PipelineTrace* trace, tbb::enumerable_thread_specific<Arena>& arenas,
+                                                 OutputNumbering& numbering)
+{
+    std::vector<PlannedFile> planned;
+
+    for (std::filesystem::path fileName; nextFile(fileName);) {
+        planned.emplace_back().fileName = std::move(fileName);
+    }
+
+    const std::size_t batchSize = reader != nullptr ? options.readAhead : planned.size();
+    std::vector<std::future<FileBuffer> > reads;
+
+    for (std::size_t begin = 0; begin < planned.size(); begin += batchSize) {
+        const std::size_t end = std::min(begin + batchSize, planned.size());
+
+        reads.clear();
+
+        if (reader != nullptr) {
+            for (std::size_t n = begin; n != end; ++n) {
+                reads.push_back(reader->read(planned[n].fileName));
+            }
+        }
+
+        tbb::parallel_for(tbb::blocked_range<std::size_t>{begin, end},
+            [&] (const tbb::blocked_range<std::size_t>& range) {
+                for (std::size_t n = range.begin(); n != range.end(); ++n) {
+                    PlannedFile& file = planned[n];
+                    std::optional<PipelineTrace::Span> span;
+
+                    if (trace != nullptr) {
+                        span.emplace(*trace, static_cast<std::size_t>(Stage::planFiles),
+                                     PipelineTrace::Clock::time_point{});
+                    }
+
+                    pascal_v1::ast::pmr::Annotations& annotations = file.annotations.emplace(&arenas.local());
+
+                    if (reader != nullptr) {
+                        const FileBuffer buffer = awaitRead(reads[n - begin], trace);
+
+                        if (!parseAnnotations(buffer, options.annotationParser, options.verifyParser, file.fileName,
+                                              annotations)) {
+                            throw std::runtime_error{"failed to parse annotations in " + file.fileName.string()};
+                        }
+                    }
+                    else {
+                        loadAnnotationFile(file.fileName, options, limitRead, archive, trace, annotations);
+                    }
+
+                    CropPlan negatives;
+                    planNegatives(annotations, options, negatives);
+
+                    for (const auto& windowNegatives : negatives) {
+                        file.numNegatives.push_back(windowNegatives.size());
+                    }
+
+                    file.count = annotations.objects.size() * numVariants(options.augmentation);
+                    file.cost = imageMemory(annotations, options.pixelFormat) +
+                                patchMemory(file.count + options.negatives.count, options.windows,
+                                            options.pixelFormat);
+
+                    if (span) {
+                        span->finish();
+                    }
+                }
+            });
+    }
+
+    for (PlannedFile& file : planned) {
+        file.firstIndex = numbering.assign(file.count);
+
+        for (std::size_t i = 0; i != file.numNegatives.size(); ++i) {
+            file.firstNegativeIndex.push_back(numbering.assignNegatives(i, file.numNegatives[i]));
+        }
+    }
+
+    return planned;
+}
+
+} // namespace
+
+struct Extractor::Impl
+{
+    explicit Impl(ExtractorOptions options)
+        : options{std::move(options)}
+        , budget{this->options.memoryBudget}
+        , conversion{makeConversion(this->options.pixelFormat, this->options.normalization)}
+    {
+        if (this->options.windows.empty()) {
+            throw std::invalid_argument{"at least one window is required"};
+        }
+
+        if (this->options.augmentation.translation < 0 || this->options.augmentation.scale < 0 ||
+            this->options.augmentation.scale >= 1) {
+            throw std::invalid_argument{"the augmentation translation must not be negative and the scale must be "
+                                        "between 0 and 1"};
+        }
+
+        if (this->options.normalization) {
+            if (CV_MAT_DEPTH(patchType(this->options.pixelFormat)) != CV_32F) {
+                throw std::invalid_argument{"normalization requires a floating point pixel format"};
+            }
+
+            for (int c = 0; c != 3; ++c) {
+                if (!(this->options.normalization->std[c] > 0)) {
+                    throw std::invalid_argument{"the standard deviations must be positive"};
+                }
+            }
+        }
+
+        if (this->options.negatives.count != 0 && !this->options.manifest.empty()) {
+            throw std::invalid_argument{"negative windows cannot be sampled together with a manifest"};
+        }
+
+        if (!this->options.archive.empty()) {
+            // Members are neither files that can be hashed and stat'ed nor
+            // worth reading ahead of the pipeline
+            if (!this->options.manifest.empty() || !this->options.imageCache.empty() ||
+                this->options.ioEngine != IoEngine::sync) {
+                throw std::invalid_argument{"an archive cannot be combined with a manifest, an image cache or "
+                                            "an asynchronous I/O engine"};
+            }
+
+            archive.emplace(this->options.archive);
+        }
+
+        if (!this->options.manifest.empty()) {
+            manifest.emplace(this->options.manifest, parametersHash(this->options));
+        }
+
+        if (this->options.imageCache.empty()) {
+            cache.emplace();
+        }
+        else {
+            cache.emplace(this->options.imageCache, this->options.imageCacheSize);
+        }
+
+        if (this->options.stats || !this->options.trace.empty()) {
+            tracing.emplace(StageNames, !this->options.trace.empty());
+        }
+
+        if (this->options.ioEngine != IoEngine::sync && this->options.readAhead == 0) {
+            throw std::invalid_argument{"the read-ahead must be positive"};
+        }
+
+        // The limit on concurrent reads bounds the reads in flight
+        const std::size_t depth = this->options.maxConcurrentReads > 0
+            ? static_cast<std::size_t>(this->options.maxConcurrentReads)
+            : this->options.readAhead;
+
+        switch (this->options.ioEngine) {
+            case IoEngine::sync:
+                break;
+            case IoEngine::threads:
+                reader = std::make_unique<ThreadPoolReader>(depth);
+                break;
+            case IoEngine::uring:
+#ifdef PAV1IET_HAVE_LIBURING
+                try {
+                    reader = std::make_unique<UringReader>(static_cast<unsigned>(std::min<std::size_t>(depth, 4096)));
+                }
+                catch (const std::runtime_error& e) {
+                    ioEngineFallback = e.what();
+                }
+#else // !PAV1IET_HAVE_LIBURING
+                ioEngineFallback = "io_uring support is not available";
+#endif // PAV1IET_HAVE_LIBURING
+
+                // Blocking reads on dedicated threads are the closest
+                // alternative
+                if (reader == nullptr) {
+                    reader = std::make_unique<ThreadPoolReader>(depth);
+                }
+
+                break;
+        }
+
+        for (const Window& window : this->options.windows) {
+            pools.push_back(std::make_unique<PatchPool>(static_cast<std::size_t>(window.windowSize.area()) *
+                                                        CV_ELEM_SIZE(conversion.type)));
+        }
+    }
+
+    ExtractorOptions options;
+    std::optional<ImageCache> cache;
+    std::optional<Manifest> manifest;
+    std::optional<PipelineTrace> tracing;
+    std::optional<TarArchive> archive;
+    // Items in flight allocate their annotations and crops from recycled
+    // arenas
+    ArenaPool arenas;
+    MemoryBudget budget;
+    PixelConversion conversion;
+    // Patches of each window are recycled once consumed
+    std::vector<std::unique_ptr<PatchPool> > pools;
+    // Reads files ahead of the pipeline unless the synchronous I/O engine is
+    // used
+    std::unique_ptr<AsyncReader> reader;
+    // Reason io_uring could not be used, if requested
+    std::string ioEngineFallback;
+    bool ran = false;
+};
+
+Extractor::Extractor(ExtractorOptions options)
+    : impl_{std::make_unique<Impl>(std::move(options))}
+{
+}
+
+Extractor::~Extractor() = default;
+
+const ExtractorOptions& Extractor::options() const noexcept
+{
+    return impl_->options;
+}
+
+bool Extractor::manifestDiscarded() const noexcept
+{
+    return impl_->manifest && impl_->manifest->discarded();
+}
+
+std::string_view Extractor::ioEngineFallback() const noexcept
+{
+    return impl_->ioEngineFallback;
+}
+
+std::string_view Extractor::archiveMember(const std::filesystem::path& name) const
+{
+    if (!impl_->archive) {
+        throw std::logic_error{"no archive was specified"};
+    }
+
+    return impl_->archive->open(name).view();
+}
+
+ExtractionSummary Extractor::run(std::istream& in, const std::filesystem::path& directory,
+                                 const PatchConsumer& consumer)
+{
+    return process([&in, &directory] (std::filesystem::path& fileName) {
+        std::string line;
+
+        if (!std::getline(in, line)) {
+            return false;
+        }
+
+        fileName = directory / line;
+        return true;
+    }, directory, consumer);
+}
+
+ExtractionSummary Extractor::run(const DirectoryScan& scan, const std::filesystem::path& root,
+                                 const PatchConsumer& consumer)
+{
+    if (scan.directories.empty()) {
+        throw std::invalid_argument{"no directories to scan"};
+    }
+
+    DirectoryScanner scanner{scan.directories, scan.pattern, scan.sorted};
+
+    return process([&scanner] (std::filesystem::path& fileName) {
+        return scanner.next(fileName);
+    }, root, consumer);
+}
+
+ExtractionSummary Extractor::process(const std::function<bool(std::filesystem::path&)>& nextFile,
+                                     const std::filesystem::path& directory, const PatchConsumer& consumer)
+{
+    if (impl_->ran) {
+        throw std::logic_error{"the extractor has already been run"};
+    }
+
+    impl_->ran = true;
+
+    const ExtractorOptions& options = impl_->options;
+    std::optional<ImageCache>& cache = impl_->cache;
+    std::optional<Manifest>& manifest = impl_->manifest;
+    ArenaPool& arenas = impl_->arenas;
+    MemoryBudget& budget = impl_->budget;
+    const std::vector<std::unique_ptr<PatchPool> >& pools = impl_->pools;
+    AsyncReader* const reader = impl_->reader.get();
+    const TarArchive* const archive = impl_->archive ? &*impl_->archive : nullptr;
+    const PixelConversion& conversion = impl_->conversion;
+    PipelineTrace* const trace = impl_->tracing ? &*impl_->tracing : nullptr;
+
+    std::atomic_size_t numProcessedFiles{0};
+    std::atomic_size_t numTotalFiles{0};
+    std::atomic_size_t numObjects{0};
+    std::atomic_size_t numPatches{0};
+    std::atomic_size_t numNegatives{0};
+    std::atomic_size_t numSkippedFiles{0};
+    // Only accessed by a serial stage unless the files are planned up
+    // front. The patches are numbered in listing order regardless of the
+    // manifest such that the numbering matches the one of an uninterrupted
+    // run from scratch.
+    OutputNumbering numbering{options.windows.size()};
+    std::condition_variable_any update;
+    std::mutex updateMonitor;
+    const ReadLimiter limitRead{options.maxConcurrentReads};
+
+    // Annotation files in listing order and the order they are processed in
+    // if the images are scheduled by their cost. The arenas hold the
+    // annotations of the planned files and must outlive them.
+    tbb::enumerable_thread_specific<Arena> planArenas;
+    std::vector<PlannedFile> planned;
+    std::vector<std::size_t> schedule;
+
+    if (options.largestFirst) {
+        planned = planFiles(nextFile, options, limitRead, archive, reader, trace, planArenas, numbering);
+
+        // Starting the expensive images first keeps them from leaving a
+        // single thread busy at the end. Ties keep the listing order.
+        schedule.resize(planned.size());
+        std::iota(schedule.begin(), schedule.end(), std::size_t{0});
+        std::ranges::stable_sort(schedule, std::ranges::greater{}, [&planned] (std::size_t n) {
+            return planned[n].cost;
+        });
+    }
+
+    // Only accessed by the serial input stage
+    std::size_t numScheduled = 0;
+    std::size_t numStarted = 0;
+
+    const auto nextScheduled = [&nextFile, &options, &planned, &schedule, &numScheduled]
+        (std::filesystem::path& fileName)
+    {
+        if (!options.largestFirst) {
+            return nextFile(fileName);
+        }
+
+        if (numScheduled == schedule.size()) {
+            return false;
+        }
+
+        fileName = planned[schedule[numScheduled++]].fileName;
+        return true;
+    };
+
+    // Progress report thread
+    std::jthread t;
+
+    if (options.progress != nullptr) {
+        t = std::jthread
+        (
+            [&numProcessedFiles, &numTotalFiles, &numObjects, &update, &updateMonitor, &progress = *options.progress] (std::stop_token token)
+            {
+                BOOST_SCOPE_EXIT(&progress)
+                {
+                    progress << '\r' << '\n';
+                }
+                BOOST_SCOPE_EXIT_END
+
+                {
+                    // Wait until the first line in the annotations listing has been
+                    // read.
+                    std::unique_lock lock{updateMonitor};
+                    update.wait(lock, token, [&numTotalFiles] {
+                        return numTotalFiles.load(std::memory_order_relaxed) != 0;
+                    });
+                }
+
+                while (!token.stop_requested()) {
+                    // The acquire load of processed synchronizes with the mutex
+                    // unlock in processObjects, making numTotalFiles >=
+                    // numProcessedFiles visible by the time total is read.
+                    const std::size_t processed = numProcessedFiles.load(std::memory_order_acquire);
+                    const std::size_t total = numTotalFiles.load(std::memory_order_relaxed);
+                    const std::size_t percent = processed * 100 / total;
+
+                    progress << '\r';
+                    progress << std::format(
+                        "processed {0} out of {1} annotations ({3} objects) ({2}% "
+                        "done)",
+                        processed, total, percent,
+                        numObjects.load(std::memory_order_relaxed));
+
+                    if (percent >= 100) {
+                        break;
+                    }
+
+                    {
+                        using namespace std::chrono_literals;
+                        constexpr auto UpdateInterval = 500ms;
+
+                        // Reduce the update rate
+                        std::unique_lock lock{updateMonitor};
+                        update.wait_for(
+                            lock, token, UpdateInterval, [processed, &numProcessedFiles] {
+                                return processed != numProcessedFiles.load(
+                                                        std::memory_order_relaxed);
+                            });
+                    }
+                }
+            }
+        );
+    }
+
+    // Annotation files whose reads were started ahead of the pipeline. Only
+    // accessed by the serial input stage.
+    std::deque<std::pair<std::filesystem::path, std::future<FileBuffer> > > readAhead;
+    bool listed = false;
+
+    // Returns the next annotation file along with its read in progress if
+    // the I/O engine is asynchronous
+    const auto nextRead = [&nextScheduled, &readAhead, &listed, &options, reader]
+        (std::filesystem::path& fileName, std::future<FileBuffer>& read)
+    {
+        // Planned files have been read already
+        if (reader == nullptr || options.largestFirst) {
+            return nextScheduled(fileName);
+        }
+
+        while (!listed && readAhead.size() < options.readAhead) {
+            std::filesystem::path next;
+
+            if (!nextScheduled(next)) {
+                listed = true;
+                break;
+            }
+
+            std::future<FileBuffer> pending = reader->read(next);
+            readAhead.emplace_back(std::move(next), std::move(pending));
+        }
+
+        if (readAhead.empty()) {
+            return false;
+        }
+
+        fileName = std::move(readAhead.front().first);
+        read = std::move(readAhead.front().second);
+        readAhead.pop_front();
+
+        return true;
+    };
+
+    const auto readFileName = tbb::make_filter<void, Item>
+    (
+        tbb::filter_mode::serial_out_of_order,
+        instrumentSource(trace, Stage::readFileName,
+        [source = t.get_stop_source(), &update, &nextRead, &numTotalFiles, &updateMonitor, &arenas, &planned,
+         &schedule, &numStarted, trace] (tbb::flow_control& fc)
+        {
+            std::filesystem::path fileName;
+            std::future<FileBuffer> read;
+            const PlannedFile* plan = nullptr;
+
+            if (!nextRead(fileName, read)) {
+                fc.stop();
+
+                if (numTotalFiles.load(std::memory_order_relaxed) == 0) {
+                    // In case no files could be read, directly notify the progress
+                    // report thread to avoid a dead lock.
+                    source.request_stop();
+                }
+            }
+            else {
+              const bool start = [&numTotalFiles, &updateMonitor] {
+                // Ensure to update numTotalFiles to avoid lost notification
+                std::scoped_lock lock{updateMonitor};
+                return numTotalFiles.fetch_add(1, std::memory_order_relaxed) ==
+                       0;
+              }();
+
+              if (start) {
+                // Start updating the progress
+                update.notify_one();
+              }
+
+              if (trace != nullptr) {
+                trace->admit();
+              }
+
+              if (!schedule.empty()) {
+                // Files are read in the order they were scheduled
+                plan = &planned[schedule[numStarted++]];
+              }
+            }
+
+            // The arena is recycled once the item leaves the pipeline
+            Item item{arenas.acquire()};
+            item.fileName = std::move(fileName);
+            item.annotationRead = std::move(read);
+            item.plan = plan;
+
+            return item;
+        })
+    );
+
+    // Read in the annotations
+    const auto loadAnnotations = tbb::make_filter<Item, Item>
+    (
+        tbb::filter_mode::parallel,
+        instrument(trace, Stage::loadAnnotations,
+        [&options, directory, &limitRead, &manifest, reader, archive, trace] (Item item)
+        {
+            const std::filesystem::path& fileName = item.fileName;
+
+            if (item.plan != nullptr) {
+                item.annotations.assign(*item.plan->annotations);
+            }
+            else if (item.annotationRead.valid()) {
+                const FileBuffer buffer = awaitRead(item.annotationRead, trace);
+
+                if (!parseAnnotations(buffer, options.annotationParser, options.verifyParser, fileName,
+                                      item.annotations)) {
+                    throw std::runtime_error{"failed to parse annotations in " + fileName.string()};
+                }
+            }
+            else {
+                loadAnnotationFile(fileName, options, limitRead, archive, trace, item.annotations);
+            }
+
+            planNegatives(item.annotations, options, item.negatives);
+
+            if (manifest) {
+                const ManifestEntry* previous = manifest->find(fileName);
+
+                item.record = describeInputs(fileName, directory / item.annotations.imageFileName, previous,
+                                             limitRead);
+                item.hashImage = previous == nullptr || previous->annotationHash != item.record.annotationHash;
+                // Confirmed by numberPatches once the output indices are
+                // known
+                item.unchanged = !item.hashImage && previous->imageHash == item.record.imageHash &&
+                                 previous->count == item.annotations.objects.size() * numVariants(options.augmentation);
+            }
+
+            // Read the image while the item waits for its turn. A persistent
+            // cache is consulted first instead since it might hold the image
+            // already.
+            if (reader != nullptr && !item.unchanged && options.imageCache.empty()) {
+                item.imageRead = reader->read(directory / item.annotations.imageFileName);
+            }
+
+            return item;
+        })
+    );
+
+    // Assign output indices in listing order such that the patches can be
+    // written in parallel while keeping their file names deterministic.
+    const auto numberPatches = tbb::make_filter<Item, Item>
+    (
+        tbb::filter_mode::serial_in_order,
+        instrument(trace, Stage::numberPatches,
+        [&numbering, &manifest, &options, directory, reader] (Item item)
+        {
+            const std::size_t count = item.annotations.objects.size() * numVariants(options.augmentation);
+
+            if (item.plan != nullptr) {
+                item.firstIndex = item.plan->firstIndex;
+                item.firstNegativeIndex.assign(item.plan->firstNegativeIndex.begin(),
+                                               item.plan->firstNegativeIndex.end());
+            }
+            else {
+                item.firstNegativeIndex.resize(item.negatives.size());
+
+                for (std::size_t i = 0; i != item.negatives.size(); ++i) {
+                    item.firstNegativeIndex[i] = numbering.assignNegatives(i, item.negatives[i].size());
+                }
+
+                item.firstIndex = numbering.assign(count);
+            }
+
+            if (!manifest) {
+                return item;
+            }
+
+            item.record.firstIndex = item.firstIndex;
+            item.record.count = count;
+
+            manifest->reserve(item.firstIndex + count);
+
+            if (item.unchanged && manifest->find(item.fileName)->firstIndex != item.firstIndex) {
+                // Annotation files listed before it gained or lost patches.
+                // The patches are written again at their new indices.
+                item.unchanged = false;
+
+                if (reader != nullptr && options.imageCache.empty()) {
+                    item.imageRead = reader->read(directory / item.annotations.imageFileName);
+                }
+            }
+
+            return item;
+        })
+    );
+
+    // Holds back images until their decoded pixels and patches fit into the
+    // memory budget. Only a single thread waits for the budget while the
+    // others keep processing the admitted items which release it.
+    const auto admitImages = tbb::make_filter<Item, Item>
+    (
+        tbb::filter_mode::serial_out_of_order,
+        instrument(trace, Stage::admitImages,
+        [&budget, &options] (Item item)
+        {
+            if (!item.unchanged) {
+                item.reservation = budget.reserve(imageMemory(item.annotations, options.pixelFormat) +
+                                                  patchMemory(item.annotations.objects.size() *
+                                                                      numVariants(options.augmentation) +
+                                                                  options.negatives.count,
+                                                              options.windows, options.pixelFormat));
+            }
+
+            return item;
+        })
+    );
+
+    // Load images
+    const auto loadImages = tbb::make_filter<Item, Item>
+    (
+        tbb::filter_mode::parallel,
+        instrument(trace, Stage::loadImages,
+        [&numObjects, directory, &limitRead, &options, &cache, archive, trace] (Item item)
+        {
+            const auto& annotations = item.annotations;
+            const std::filesystem::path imageFileName = directory / annotations.imageFileName;
+
+            numObjects.fetch_add(annotations.objects.size(), std::memory_order_relaxed);
+
+            if (item.unchanged) {
+                return item;
+            }
+
+            // The image might need to be decoded twice
+            std::optional<FileBuffer> prefetched;
+
+            if (item.imageRead.valid()) {
+                prefetched = awaitRead(item.imageRead, trace);
+            }
+            else if (archive != nullptr) {
+                // Decoded straight from the mapping of the archive
+                prefetched = archive->open(imageFileName);
+
+                if (trace != nullptr) {
+                    trace->read(prefetched->size());
+                }
+            }
+
+            // Reads and decodes the image unless it is already cached
+            const auto load = [&imageFileName, &limitRead, &cache, &prefetched, &item, trace] (int mode) {
+                return cache->load(imageFileName, mode, [&imageFileName, &limitRead, &prefetched, &item, trace,
+                                                         mode] {
+                    FileBuffer buffer;
+
+                    if (prefetched) {
+                        buffer = *prefetched;
+                    }
+                    else {
+                        const PipelineTrace::Clock::time_point begin = PipelineTrace::Clock::now();
+
+                        // Only the read is throttled; the decode runs
+                        // unrestricted.
+                        buffer = limitRead([&imageFileName] {
+                            return FileBuffer::read(imageFileName);
+                        });
+
+                        if (trace != nullptr) {
+                            trace->ioWait(PipelineTrace::Clock::now() - begin);
+                            trace->read(buffer.size());
+                        }
+                    }
+
+                    if (item.hashImage) {
+                        // Avoids reading the image a second time
+                        item.record.imageHash = Fnv1a{}.update(buffer.data(), buffer.size()).value();
+                        item.hashImage = false;
+                    }
+
+                    if (buffer.empty()) {
+                        return cv::Mat{};
+                    }
+
+                    const cv::Mat encoded{1, static_cast<int>(buffer.size()), CV_8UC1,
+                                          const_cast<char*>(buffer.data())};
+
+                    return cv::imdecode(encoded, mode);
+                });
+            };
+
+            if (options.reducedDecode && (!annotations.objects.empty() || options.negatives.count != 0)) {
+                // Plan the crops in advance using the annotated image size
+                // and skip decoding pixels that would be discarded while
+                // downsampling.
+                planCrops(annotations, annotations.imageSize.height, options.windows, item.crops);
+                item.reduction = decodeReduction(item.crops, item.negatives, options.windows, options.augmentation);
+            }
+
+            // Unused channels are never decoded
+            const bool grayscale = decodeGrayscale(annotations, options.pixelFormat);
+
+            std::tie(item.image, item.imageOwner) = load(reducedImreadMode(item.reduction, grayscale));
+
+            if (item.reduction > 1 && !item.image.empty() &&
+                !matchesReducedSize(item.image.size(), annotations.imageSize, item.reduction)) {
+                // The annotated image size is not reliable. Fall back to full
+                // resolution and plan the crops once decoded.
+                item.crops.clear();
+                item.reduction = 1;
+                std::tie(item.image, item.imageOwner) = load(reducedImreadMode(1, grayscale));
+            }
+
+            if (item.image.empty()) {
+                throw std::invalid_argument{"failed to read image " + imageFileName.string()};
+            }
+
+            if (item.hashImage) {
+                // The cached pixels were used without reading the image
+                item.record.imageHash = limitRead([&imageFileName] {
+                    return hashFileContents(imageFileName);
+                });
+            }
+
+            return item;
+        })
+    );
+
+    const auto processObjects = tbb::make_filter<Item, Item>
+    (
+        tbb::filter_mode::parallel,
+        instrument(trace, Stage::processObjects,
+        [&numProcessedFiles, &update, &updateMonitor, &options, &pools, &conversion, trace] (Item item)
+        {
+            const auto& annotations = item.annotations;
+            const cv::Mat& image = item.image;
+
+            if (item.crops.empty() && !item.unchanged) {
+                // Plan the crops using the actual image dimensions
+                planCrops(annotations, image.rows, options.windows, item.crops);
+            }
+
+            // Unchanged annotation files yield no patches
+            item.crops.resize(options.windows.size());
+            item.variants.resize(options.windows.size());
+            item.patches.resize(options.windows.size());
+
+            const std::size_t numObjectVariants = numVariants(options.augmentation);
+            // Start of the patches of each window in the sequence of all the
+            // patches of the image
+            std::pmr::vector<std::size_t> offsets{item.arena.get()};
+            offsets.reserve(options.windows.size() + 1);
+            offsets.push_back(0);
+
+            // The variants are sampled up front such that they do not depend
+            // on the order the patches are extracted in
+            for (std::size_t i = 0; i != options.windows.size(); ++i) {
+                std::mt19937_64 rng =
+                    makeGenerator(options.seed, std::string_view{annotations.imageFileName}, i,
+                                  std::string_view{"augmentation"});
+
+                item.variants[i].reserve(item.crops[i].size() * numObjectVariants);
+
+                for (std::size_t j = 0; j != item.crops[i].size(); ++j) {
+                    planVariants(options.augmentation, rng, item.variants[i]);
+                }
+
+                item.patches[i].resize(item.variants[i].size() + (item.unchanged ? 0 : item.negatives[i].size()));
+                offsets.push_back(offsets.back() + item.patches[i].size());
+            }
+
+            // Each variant is warped directly from the source image which is
+            // shared by all the windows
+            const auto extract = [&] (std::size_t i, std::size_t j) {
+                const cv::Size& windowSize = options.windows[i].windowSize;
+                const std::size_t numObjectPatches = item.variants[i].size();
+                const bool object = j < numObjectPatches;
+                const Crop& crop = object ? item.crops[i][j / numObjectVariants]
+                                          : item.negatives[i][j - numObjectPatches];
+
+                cv::Mat patch;
+                patch.allocator = pools[i].get();
+
+                const cv::Matx23f M = augmentTransform(cropTransform(crop, windowSize, item.reduction), windowSize,
+                                                       object ? item.variants[i][j] : Variant{});
+                const cv::InterpolationFlags flags = cropInterpolation(crop, windowSize, item.reduction);
+
+                extractPatch(image, patch, M, windowSize, flags, options.cropKernel, options.verifyCropKernel,
+                             conversion);
+
+                item.patches[i][j] = std::move(patch);
+            };
+
+            // Crowded images are split into tasks of a few patches each
+            // instead of holding up the items behind them. Every patch is
+            // stored at its own position which preserves the output order.
+            // While waiting for the tasks, the thread must not pick up other
+            // items which would delay this one again.
+            const std::thread::id caller = std::this_thread::get_id();
+
+            tbb::this_task_arena::isolate([&offsets, &extract, caller, trace] {
+                tbb::parallel_for(tbb::blocked_range<std::size_t>{0, offsets.back(), PatchesPerTask},
+                    [&offsets, &extract, caller, trace] (const tbb::blocked_range<std::size_t>& range) {
+                        // Tasks run by the calling thread are already
+                        // measured as part of the stage invocation
+                        const bool nested = trace != nullptr && std::this_thread::get_id() != caller;
+                        const std::chrono::nanoseconds cpuBegin =
+                            nested ? threadCpuTime() : std::chrono::nanoseconds::zero();
+
+                        for (std::size_t n = range.begin(); n != range.end(); ++n) {
+                            const std::size_t i = static_cast<std::size_t>(
+                                std::upper_bound(offsets.begin(), offsets.end(), n) - offsets.begin()) - 1;
+                            extract(i, n - offsets[i]);
+                        }
+
+                        if (nested) {
+                            trace->nestedCpu(Stage::processObjects, threadCpuTime() - cpuBegin);
+                        }
+                    });
+            });
+
+            // The decoded image is not needed anymore
+            item.image.release();
+            item.imageOwner.reset();
+            item.reservation.shrink(patchMemory(annotations.objects.size() * numVariants(options.augmentation) +
+                                                    options.negatives.count,
+                                                options.windows, options.pixelFormat));
+
+            {
+                std::scoped_lock lock{updateMonitor};
+                numProcessedFiles.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            // Update notifying update to limit the update rate
+
+            return item;
+        })
+    );
+
+    // Output indices are known in advance. Patches can be therefore consumed
+    // in any order.
+    const auto consumePatches = tbb::make_filter<Item, void>
+    (
+        tbb::filter_mode::parallel,
+        instrument(trace, Stage::consumePatches,
+        [&numPatches, &numNegatives, &numSkippedFiles, &consumer, &options, &manifest] (Item item)
+        {
+            for (std::size_t i = 0; i != item.patches.size(); ++i) {
+                const std::pmr::vector<cv::Mat>& patches = item.patches[i];
+                const cv::Size& windowSize = options.windows[i].windowSize;
+                const std::size_t numObjectVariants = numVariants(options.augmentation);
+                const std::size_t numObjectPatches = item.variants[i].size();
+
+                for (std::size_t j = 0; j != numObjectPatches; ++j) {
+                    const auto& object = item.annotations.objects[j / numObjectVariants];
+                    const PatchInfo info{
+                        item.firstIndex + j, i, item.fileName,
+                        ObjectInfo{object.id, object.name, object.label, object.centerPoint, object.boundingBox},
+                        augmentTransform(cropTransform(item.crops[i][j / numObjectVariants], windowSize), windowSize,
+                                         item.variants[i][j]),
+                        false, j % numObjectVariants};
+
+                    consumer(info, patches[j]);
+
+                    numPatches.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                for (std::size_t j = numObjectPatches; j != patches.size(); ++j) {
+                    const Crop& crop = item.negatives[i][j - numObjectPatches];
+                    const cv::Point center{static_cast<int>(crop.center.x), static_cast<int>(crop.center.y)};
+                    const cv::Rect region{
+                        static_cast<int>(std::lround(crop.center.x - static_cast<float>(crop.size.width) / 2.0f)),
+                        static_cast<int>(std::lround(crop.center.y - static_cast<float>(crop.size.height) / 2.0f)),
+                        crop.size.width, crop.size.height};
+                    const PatchInfo info{
+                        item.firstNegativeIndex[i] + j - numObjectPatches, i, item.fileName,
+                        ObjectInfo{0, {}, {}, center, region}, cropTransform(crop, windowSize), true};
+
+                    consumer(info, patches[j]);
+
+                    numPatches.fetch_add(1, std::memory_order_relaxed);
+                    numNegatives.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+
+            if (!manifest) {
+                return;
+            }
+
+            if (item.unchanged) {
+                manifest->keep(item.fileName, item.record);
+                numSkippedFiles.fetch_add(1, std::memory_order_relaxed);
+            }
+            else {
+                // All the patches of the annotation file have been consumed
+                manifest->commit(item.fileName, item.record);
+            }
+        })
+    );
+
+    const std::size_t concurrency = std::max(std::thread::hardware_concurrency(), 1u);
+    // The memory budget bounds the decoded images instead of the number of
+    // items in flight. More items can be therefore admitted to keep the
+    // cores busy while some of them wait for the budget.
+    const std::size_t maxTokens =
+        options.maxTokens != 0 ? options.maxTokens : budget.enabled() ? 4 * concurrency : concurrency;
+
+    std::optional<tbb::global_control> parallelism;
+
+    if (budget.enabled() && concurrency < 2) {
+        // The thread waiting for the budget depends on another thread to
+        // release it
+        parallelism.emplace(tbb::global_control::max_allowed_parallelism, 2);
+    }
+
+    // On failure, the progress report thread is stopped once destroyed
+    if (budget.enabled()) {
+        tbb::parallel_pipeline
+        (
+              maxTokens
+            , readFileName
+            & loadAnnotations
+            & numberPatches
+            & admitImages
+            & loadImages
+            & processObjects
+            & consumePatches
+        );
+    }
+    else {
+        tbb::parallel_pipeline
+        (
+              maxTokens
+            , readFileName
+            & loadAnnotations
+            & numberPatches
+            & loadImages
+            & processObjects
+            & consumePatches
+        );
+    }
+
+    // Patches past the end of the current run are left over from previous
+    // runs
+    std::size_t firstStaleIndex = 0;
+    std::size_t endStaleIndex = 0;
+
+    if (manifest) {
+        firstStaleIndex = numbering.end();
+        endStaleIndex = std::max(firstStaleIndex, manifest->previousEndIndex());
+
+        manifest->compact();
+    }
+
+    if (!options.trace.empty()) {
+        trace->writeEvents(options.trace);
+    }
+
+    if (t.joinable()) {
+        // Wait until the progress report thread exists
+        t.join();
+    }
+
+    ExtractionSummary summary;
+    summary.numFiles = numTotalFiles.load(std::memory_order_relaxed);
+    summary.numObjects = numObjects.load(std::memory_order_relaxed);
+    summary.numPatches = numPatches.load(std::memory_order_relaxed);
+    summary.numNegatives = numNegatives.load(std::memory_order_relaxed);
+    summary.numSkippedFiles = numSkippedFiles.load(std::memory_order_relaxed);
+    summary.firstStaleIndex = firstStaleIndex;
+    summary.endStaleIndex = endStaleIndex;
+    summary.imageCacheHits = cache->hits();
+    summary.imageCacheMisses = cache->misses();
+
+    return summary;
+}
+
+void Extractor::printStatistics(std::ostream& out, std::uintmax_t bytesWritten) const
+{
+    if (!impl_->tracing) {
+        return;
+    }
+
+    impl_->tracing->summarize(out, bytesWritten);
+
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+    std::size_t capacity = 0;
+
+    for (const auto& pool : impl_->pools) {
+        hits += pool->hits();
+        misses += pool->misses();
+        capacity += pool->capacity();
+    }
+
+    out << std::format("patch pool: {} hits, {} misses, {:.1f} MiB allocated", hits, misses,
+                       static_cast<double>(capacity) / (1024.0 * 1024.0))
+        << std::endl;
+
+    if (impl_->budget.enabled()) {
+        out << std::format("memory budget: peak {:.1f} MiB of {:.1f} MiB reserved",
+                           static_cast<double>(impl_->budget.peak()) / (1024.0 * 1024.0),
+                           static_cast<double>(impl_->budget.limit()) / (1024.0 * 1024.0))
+            << std::endl;
+    }
+}
+
+struct PatchStream::Queue
+{
+    // Thrown by the consumer to cancel the extraction
+    struct Cancelled
+    {
+    };
+
+    explicit Queue(std::size_t capacity)
+    {
+        patches.set_capacity(static_cast<std::ptrdiff_t>(std::max<std::size_t>(capacity, 1)));
+    }
+
+    // The end of the stream is denoted by an empty patch
+    tbb::concurrent_bounded_queue<std::optional<Patch> > patches;
+    std::atomic_bool cancelled{false};
+};
+
+PatchStream::PatchStream(Extractor& extractor, std::istream& listing, std::filesystem::path directory,
+                         std::size_t capacity)
+    : queue_{std::make_unique<Queue>(capacity)}
+{
+    start([&extractor, &listing, directory = std::move(directory)] (const PatchConsumer& consumer) {
+        return extractor.run(listing, directory, consumer);
+    });
+}
+
+PatchStream::PatchStream(Extractor& extractor, DirectoryScan scan, std::filesystem::path root,
+                         std::size_t capacity)
+    : queue_{std::make_unique<Queue>(capacity)}
+{
+    start([&extractor, scan = std::move(scan), root = std::move(root)] (const PatchConsumer& consumer) {
+        return extractor.run(scan, root, consumer);
+    });
+}
+
+void PatchStream::start(std::function<ExtractionSummary(const PatchConsumer&)> run)
+{
+    producer_ = std::thread{[this, run = std::move(run)] {
+        try {
+            summary_ = run([this] (const PatchInfo& info, const cv::Mat& patch) {
+                if (queue_->cancelled.load(std::memory_order_relaxed)) {
+                    throw Queue::Cancelled{};
+                }
+
+                queue_->patches.push(Patch{info.index, info.window, info.annotationFileName, info.object.id,
+                                           std::string{info.object.name}, std::string{info.object.label},
+                                           info.object.centerPoint, info.object.boundingBox, info.transform,
+                                           info.negative, info.variant, patch});
+            });
+        }
+        catch (const Queue::Cancelled&) {
+        }
+        catch (...) {
+            error_ = std::current_exception();
+        }
+
+        queue_->patches.push(std::nullopt);
+    }};
+}
+
+PatchStream::~PatchStream()
+{
+    queue_->cancelled.store(true, std::memory_order_relaxed);
+
+    // Make room for the producer until it reaches the end
+    for (std::optional<Patch> patch; !done_; done_ = !patch) {
+        queue_->patches.pop(patch);
+    }
+
+    producer_.join();
+}
+
+std::optional<Patch> PatchStream::next()
+{
+    if (done_) {
+        return std::nullopt;
+    }
+
+    std::optional<Patch> patch;
+    queue_->patches.pop(patch);
+
+    if (!patch) {
+        done_ = true;
+
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+    }
+
+    return patch;
+}
+
+const ExtractionSummary& PatchStream::summary() const noexcept
+{
+    return summary_;
+}
+
+} // namespace pav1iet
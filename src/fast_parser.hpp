@@ -0,0 +1,460 @@
+//
+// pav1iet - PASCAL Annotation Version 1.00 Extractor Tool
+// Copyright (C) 2026 Sergiu Deitsch <sergiu.deitsch@gmail.com>
+//
+// This file is part of pav1iet.
+//
+// pav1iet is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pav1iet is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pav1iet.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef PAV1IET_FAST_PARSER_HPP
+#define PAV1IET_FAST_PARSER_HPP
+
+#include <opencv2/core/core.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "ast.hpp"
+
+namespace pascal_v1 {
+
+namespace fast {
+
+// Object whose strings refer to the parsed text
+struct ObjectView
+{
+    unsigned id;
+    std::string_view name;
+    std::string_view label;
+    cv::Point centerPoint;
+    cv::Rect boundingBox;
+};
+
+// Annotations preceding the objects
+struct HeaderView
+{
+    std::string_view imageFileName;
+    cv::Size imageSize;
+    int channels;
+    std::string_view database;
+    cv::Point topLeft;
+};
+
+namespace detail {
+
+// Recursive descent over a contiguous buffer accepting the same language as
+// the pascal_v1::annotation grammar with a whitespace skipper. Whitespace is
+// skipped before each token but not within literals. Text between the
+// annotations is located using substring searches instead of attempting a
+// parse at every offset.
+class Scanner
+{
+public:
+    explicit Scanner(std::string_view text) noexcept
+        : text_{text}
+    {
+    }
+
+    [[nodiscard]] std::size_t position() const noexcept
+    {
+        return pos_;
+    }
+
+    void seek(std::size_t pos) noexcept
+    {
+        pos_ = pos;
+    }
+
+    // Returns the offset of the next occurrence of the string at or after
+    // the offset
+    [[nodiscard]] std::size_t find(std::string_view s, std::size_t offset) const noexcept
+    {
+        return text_.find(s, offset);
+    }
+
+    void skip() noexcept
+    {
+        while (pos_ != text_.size() && isSpace(text_[pos_])) {
+            ++pos_;
+        }
+    }
+
+    [[nodiscard]] bool atEnd() noexcept
+    {
+        skip();
+        return pos_ == text_.size();
+    }
+
+    [[nodiscard]] bool literal(std::string_view s) noexcept
+    {
+        skip();
+
+        if (text_.substr(pos_, s.size()) != s) {
+            return false;
+        }
+
+        pos_ += s.size();
+        return true;
+    }
+
+    [[nodiscard]] bool literal(char c) noexcept
+    {
+        skip();
+
+        if (pos_ == text_.size() || text_[pos_] != c) {
+            return false;
+        }
+
+        ++pos_;
+        return true;
+    }
+
+    [[nodiscard]] std::optional<unsigned> unsignedInteger() noexcept
+    {
+        skip();
+
+        const std::optional<std::uint64_t> value = digits();
+
+        if (!value || *value > std::numeric_limits<unsigned>::max()) {
+            return std::nullopt;
+        }
+
+        return static_cast<unsigned>(*value);
+    }
+
+    [[nodiscard]] std::optional<int> integer() noexcept
+    {
+        skip();
+
+        bool negative = false;
+
+        if (pos_ != text_.size() && (text_[pos_] == '-' || text_[pos_] == '+')) {
+            negative = text_[pos_++] == '-';
+        }
+
+        const std::optional<std::uint64_t> value = digits();
+        const std::uint64_t limit = static_cast<std::uint64_t>(std::numeric_limits<int>::max()) + (negative ? 1 : 0);
+
+        if (!value || *value > limit) {
+            return std::nullopt;
+        }
+
+        return negative ? static_cast<int>(-static_cast<std::int64_t>(*value)) : static_cast<int>(*value);
+    }
+
+    // Non-empty text enclosed in double quotes. As with the grammar, leading
+    // whitespace within the quotes is skipped.
+    [[nodiscard]] std::optional<std::string_view> quotedString() noexcept
+    {
+        if (!literal('"')) {
+            return std::nullopt;
+        }
+
+        skip();
+
+        const std::size_t end = text_.find('"', pos_);
+
+        if (end == std::string_view::npos || end == pos_) {
+            return std::nullopt;
+        }
+
+        const std::string_view value = text_.substr(pos_, end - pos_);
+        pos_ = end + 1;
+
+        return value;
+    }
+
+    [[nodiscard]] std::optional<cv::Point> point() noexcept
+    {
+        if (!literal('(')) {
+            return std::nullopt;
+        }
+
+        const std::optional<int> x = integer();
+
+        if (!x || !literal(',')) {
+            return std::nullopt;
+        }
+
+        const std::optional<int> y = integer();
+
+        if (!y || !literal(')')) {
+            return std::nullopt;
+        }
+
+        return cv::Point{*x, *y};
+    }
+
+private:
+    [[nodiscard]] static bool isSpace(char c) noexcept
+    {
+        return c == ' ' || (c >= '\t' && c <= '\r');
+    }
+
+    [[nodiscard]] std::optional<std::uint64_t> digits() noexcept
+    {
+        const std::size_t first = pos_;
+        std::uint64_t value = 0;
+
+        while (pos_ != text_.size() && text_[pos_] >= '0' && text_[pos_] <= '9') {
+            value = value * 10 + static_cast<unsigned>(text_[pos_] - '0');
+
+            if (value > std::numeric_limits<std::uint32_t>::max()) {
+                return std::nullopt;
+            }
+
+            ++pos_;
+        }
+
+        if (pos_ == first) {
+            return std::nullopt;
+        }
+
+        return value;
+    }
+
+    std::string_view text_;
+    std::size_t pos_ = 0;
+};
+
+inline constexpr std::string_view OriginalLabel = "Original label for object";
+
+[[nodiscard]] inline bool parseTopLeft(Scanner& s, cv::Point& topLeft) noexcept
+{
+    if (!s.literal('#') || !s.literal("Top left pixel co-ordinates :")) {
+        return false;
+    }
+
+    const std::optional<cv::Point> p = s.point();
+
+    if (!p) {
+        return false;
+    }
+
+    topLeft = *p;
+    return true;
+}
+
+[[nodiscard]] inline bool parseObject(Scanner& s, ObjectView& object) noexcept
+{
+    if (!s.literal(OriginalLabel)) {
+        return false;
+    }
+
+    const std::optional<unsigned> id = s.unsignedInteger();
+    const std::optional<std::string_view> name = id ? s.quotedString() : std::nullopt;
+
+    if (!name || !s.literal(':')) {
+        return false;
+    }
+
+    const std::optional<std::string_view> label = s.quotedString();
+
+    if (!label || !s.literal("Center point on object") || !s.unsignedInteger() || !s.quotedString() ||
+        !s.literal("(X, Y)") || !s.literal(':')) {
+        return false;
+    }
+
+    const std::optional<cv::Point> center = s.point();
+
+    if (!center || !s.literal("Bounding box for object") || !s.unsignedInteger() || !s.quotedString() ||
+        !s.literal("(Xmin, Ymin) - (Xmax, Ymax)") || !s.literal(':')) {
+        return false;
+    }
+
+    const std::optional<cv::Point> tl = s.point();
+
+    if (!tl || !s.literal('-')) {
+        return false;
+    }
+
+    const std::optional<cv::Point> br = s.point();
+
+    if (!br) {
+        return false;
+    }
+
+    object = ObjectView{*id, *name, *label, *center, cv::Rect{*tl, *br}};
+    return true;
+}
+
+// Finds the next position at which the parse succeeds by trying each
+// occurrence of the token the parse starts with
+template<class Parse>
+[[nodiscard]] bool parseNext(Scanner& s, std::string_view token, Parse&& parse)
+{
+    for (std::size_t pos = s.find(token, s.position()); pos != std::string_view::npos;
+         pos = s.find(token, pos + 1)) {
+        s.seek(pos);
+
+        if (parse(s)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+} // namespace detail
+
+// Parses PASCAL v1 annotations without allocating memory. The handler is
+// invoked with each object name of the ground truth list, then once with the
+// header and afterwards with each object. All string views point into the
+// text. The accepted language is the same as the one of
+// pascal_v1::annotation >> eoi.
+template<class Handler>
+[[nodiscard]] bool parse(std::string_view text, Handler&& handler)
+{
+    detail::Scanner s{text};
+    HeaderView header;
+
+    if (!s.literal('#') || !s.literal("PASCAL Annotation Version 1.00")) {
+        return false;
+    }
+
+    const auto imageFileName = s.literal("Image filename :") ? s.quotedString() : std::nullopt;
+
+    if (!imageFileName || !s.literal("Image size (X x Y x C) :")) {
+        return false;
+    }
+
+    header.imageFileName = *imageFileName;
+
+    const std::optional<int> width = s.integer();
+    const std::optional<int> height = width && s.literal('x') ? s.integer() : std::nullopt;
+    const std::optional<int> channels = height && s.literal('x') ? s.integer() : std::nullopt;
+
+    if (!channels) {
+        return false;
+    }
+
+    header.imageSize = cv::Size{*width, *height};
+    header.channels = *channels;
+
+    const auto database = s.literal("Database :") ? s.quotedString() : std::nullopt;
+
+    if (!database || !s.literal("Objects with ground truth :") || !s.unsignedInteger() || !s.literal('{')) {
+        return false;
+    }
+
+    header.database = *database;
+
+    std::size_t numNames = 0;
+
+    for (;;) {
+        const std::size_t pos = s.position();
+        const std::optional<std::string_view> name = s.quotedString();
+
+        if (!name) {
+            s.seek(pos);
+            break;
+        }
+
+        handler.objectName(*name);
+        ++numNames;
+    }
+
+    if (numNames == 0 || !s.literal('}')) {
+        return false;
+    }
+
+    if (!detail::parseNext(s, "#", [&header] (detail::Scanner& s) {
+            return detail::parseTopLeft(s, header.topLeft);
+        })) {
+        return false;
+    }
+
+    handler.header(header);
+
+    std::size_t numObjects = 0;
+    ObjectView object;
+
+    for (;;) {
+        const std::size_t pos = s.position();
+
+        if (!detail::parseNext(s, detail::OriginalLabel, [&object] (detail::Scanner& s) {
+                return detail::parseObject(s, object);
+            })) {
+            s.seek(pos);
+            break;
+        }
+
+        handler.object(object);
+        ++numObjects;
+    }
+
+    return numObjects > 0 && s.atEnd();
+}
+
+namespace detail {
+
+// Stores the parsed annotations in either of the AST flavors
+template<class Annotations>
+struct AnnotationsBuilder
+{
+    void objectName(std::string_view name)
+    {
+        annotations.objectNames.emplace_back(name);
+    }
+
+    void header(const HeaderView& header)
+    {
+        annotations.imageFileName = header.imageFileName;
+        annotations.imageSize = header.imageSize;
+        annotations.channels = header.channels;
+        annotations.database = header.database;
+        annotations.topLeft = header.topLeft;
+    }
+
+    void object(const ObjectView& object)
+    {
+        if constexpr (std::is_same_v<Annotations, ast::pmr::Annotations>) {
+            annotations.objects.emplace_back(object.id, object.name, object.label, object.centerPoint,
+                                             object.boundingBox);
+        }
+        else {
+            annotations.objects.push_back(ast::Object{object.id, std::string{object.name},
+                                                      std::string{object.label}, object.centerPoint,
+                                                      object.boundingBox});
+        }
+    }
+
+    Annotations& annotations;
+};
+
+} // namespace detail
+
+// Parses the annotations into the AST produced by the grammar
+[[nodiscard]] inline bool parse(std::string_view text, ast::Annotations& annotations)
+{
+    return parse(text, detail::AnnotationsBuilder<ast::Annotations>{annotations});
+}
+
+// Parses the annotations using the allocator of the AST only
+[[nodiscard]] inline bool parse(std::string_view text, ast::pmr::Annotations& annotations)
+{
+    return parse(text, detail::AnnotationsBuilder<ast::pmr::Annotations>{annotations});
+}
+
+} // namespace fast
+
+} // namespace pascal_v1
+
+#endif // PAV1IET_FAST_PARSER_HPP
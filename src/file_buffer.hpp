@@ -0,0 +1,183 @@
+//
+// pav1iet - PASCAL Annotation Version 1.00 Extractor Tool
+// Copyright (C) 2026 Sergiu Deitsch <sergiu.deitsch@gmail.com>
+//
+// This file is part of pav1iet.
+//
+// pav1iet is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pav1iet is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pav1iet.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef PAV1IET_FILE_BUFFER_HPP
+#define PAV1IET_FILE_BUFFER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+namespace pav1iet {
+
+// Read-only view of a file's contents in contiguous memory. The storage is
+// either a private memory mapping or a heap buffer filled by a single bulk
+// read. Copies share the underlying storage.
+class FileBuffer
+{
+public:
+    FileBuffer() = default;
+
+    // Maps the whole file into memory.
+    [[nodiscard]] static FileBuffer map(const std::filesystem::path& fileName)
+    {
+        namespace bip = boost::interprocess;
+
+        if (!std::filesystem::is_regular_file(fileName)) {
+            // Pipes and character devices cannot be mapped
+            return read(fileName);
+        }
+
+        const std::uintmax_t size = fileSize(fileName);
+
+        if (size == 0) {
+            // Zero-length regions cannot be mapped
+            return FileBuffer{};
+        }
+
+        try {
+            const bip::file_mapping mapping{fileName.c_str(), bip::read_only};
+            auto region = std::make_shared<bip::mapped_region>(mapping, bip::read_only);
+            // Annotations are scanned front to back exactly once
+            region->advise(bip::mapped_region::advice_sequential);
+
+            return FileBuffer{static_cast<const char*>(region->get_address()),
+                              region->get_size(), std::move(region)};
+        }
+        catch (const bip::interprocess_exception& e) {
+            throw std::runtime_error{"failed to map " + fileName.string() + ": " + e.what()};
+        }
+    }
+
+    // Reads the whole file into a heap buffer using a single read call.
+    [[nodiscard]] static FileBuffer read(const std::filesystem::path& fileName)
+    {
+        std::ifstream in{fileName, std::ios_base::binary};
+
+        if (!in) {
+            throw std::runtime_error{"failed to open " + fileName.string()};
+        }
+
+        std::shared_ptr<std::vector<char> > storage;
+
+        if (!std::filesystem::is_regular_file(fileName)) {
+            // The size of a pipe is not known in advance
+            storage = std::make_shared<std::vector<char> >(
+                std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{});
+
+            if (in.bad()) {
+                throw std::runtime_error{"failed to read " + fileName.string()};
+            }
+        }
+        else {
+            storage = std::make_shared<std::vector<char> >(fileSize(fileName));
+
+            if (!in.read(storage->data(), static_cast<std::streamsize>(storage->size()))) {
+                throw std::runtime_error{"failed to read " + fileName.string()};
+            }
+        }
+
+        return FileBuffer{storage->data(), storage->size(), std::move(storage)};
+    }
+
+    // Takes ownership of the contents read by other means
+    [[nodiscard]] static FileBuffer adopt(std::shared_ptr<const std::vector<char> > storage) noexcept
+    {
+        const char* const data = storage->data();
+        const std::size_t size = storage->size();
+
+        return FileBuffer{data, size, std::move(storage)};
+    }
+
+    // View of a part of the contents sharing the storage
+    [[nodiscard]] FileBuffer slice(std::size_t offset, std::size_t size) const noexcept
+    {
+        return FileBuffer{data_ + offset, size, owner_};
+    }
+
+    [[nodiscard]] const char* data() const noexcept
+    {
+        return data_;
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return size_ == 0;
+    }
+
+    [[nodiscard]] const char* begin() const noexcept
+    {
+        return data_;
+    }
+
+    [[nodiscard]] const char* end() const noexcept
+    {
+        return data_ + size_;
+    }
+
+    [[nodiscard]] std::string_view view() const noexcept
+    {
+        return {data_, size_};
+    }
+
+private:
+    FileBuffer(const char* data, std::size_t size, std::shared_ptr<const void> owner) noexcept
+        : data_{data}
+        , size_{size}
+        , owner_{std::move(owner)}
+    {
+    }
+
+    [[nodiscard]] static std::uintmax_t fileSize(const std::filesystem::path& fileName)
+    {
+        std::error_code ec;
+        const std::uintmax_t size = std::filesystem::file_size(fileName, ec);
+
+        if (ec) {
+            throw std::runtime_error{"failed to open " + fileName.string() + ": " + ec.message()};
+        }
+
+        return size;
+    }
+
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+    std::shared_ptr<const void> owner_;
+};
+
+} // namespace pav1iet
+
+#endif // PAV1IET_FILE_BUFFER_HPP
@@ -0,0 +1,269 @@
+//
+// pav1iet - PASCAL Annotation Version 1.00 Extractor Tool
+// Copyright (C) 2026 Sergiu Deitsch <sergiu.deitsch@gmail.com>
+//
+// This file is part of pav1iet.
+//
+// pav1iet is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pav1iet is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pav1iet.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef PAV1IET_FRAME_WRITER_HPP
+#define PAV1IET_FRAME_WRITER_HPP
+
+#include <opencv2/core/core.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <boost/interprocess/exceptions.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+
+#include <pav1iet/frame.hpp>
+
+#include "patch_writer.hpp"
+
+namespace pav1iet {
+
+// Transport of the frames shared by the writers of all the windows. Frames
+// are written one at a time. Writing blocks while the consumer lags behind,
+// which in turn stalls the extraction.
+class FrameSink
+{
+public:
+    virtual ~FrameSink() = default;
+
+    virtual void write(const FrameHeader& header, const cv::Mat& patch) = 0;
+
+    // Called after the last frame, possibly more than once
+    virtual void finish() = 0;
+};
+
+// Writes the frames back to back to a file, typically standard output
+// connected to a pipe. The pipe buffer bounds the number of frames in flight.
+class StreamFrameSink final : public FrameSink
+{
+public:
+    explicit StreamFrameSink(std::FILE* out) noexcept
+        : out_{out}
+    {
+    }
+
+    void write(const FrameHeader& header, const cv::Mat& patch) override
+    {
+        std::scoped_lock lock{mutex_};
+
+        bool ok = std::fwrite(&header, sizeof header, 1, out_) == 1;
+
+        if (patch.isContinuous()) {
+            ok = ok && std::fwrite(patch.data, header.size, 1, out_) == 1;
+        }
+        else {
+            const std::size_t rowBytes = static_cast<std::size_t>(patch.cols) * patch.elemSize();
+
+            for (int y = 0; ok && y != patch.rows; ++y) {
+                ok = std::fwrite(patch.ptr(y), rowBytes, 1, out_) == 1;
+            }
+        }
+
+        if (!ok) {
+            throw std::runtime_error{"failed to write to standard output"};
+        }
+    }
+
+    void finish() override
+    {
+        std::scoped_lock lock{mutex_};
+
+        if (std::fflush(out_) != 0) {
+            throw std::runtime_error{"failed to write to standard output"};
+        }
+    }
+
+private:
+    std::FILE* out_;
+    std::mutex mutex_;
+};
+
+// Single producer, single consumer ring buffer in a named shared memory
+// object as described by RingHeader. The consumer process maps the object
+// and reads the pixels in place before releasing the frames. The object is
+// recreated on construction and left behind for the consumer to remove.
+class RingFrameSink final : public FrameSink
+{
+public:
+    RingFrameSink(std::string name, std::uint64_t capacity)
+        : name_{std::move(name)}
+        , capacity_{capacity / FrameAlignment * FrameAlignment}
+    {
+        namespace bip = boost::interprocess;
+
+        if (capacity_ < alignedFrameSize(0)) {
+            throw std::invalid_argument{"the ring buffer size is too small"};
+        }
+
+        try {
+            bip::shared_memory_object::remove(name_.c_str());
+
+            bip::shared_memory_object shm{bip::create_only, name_.c_str(), bip::read_write};
+            shm.truncate(static_cast<bip::offset_t>(RingDataOffset + capacity_));
+
+            region_ = bip::mapped_region{shm, bip::read_write};
+        }
+        catch (const bip::interprocess_exception& e) {
+            throw std::runtime_error{"failed to create shared memory object " + name_ + ": " + e.what()};
+        }
+
+        header_ = new (region_.get_address()) RingHeader{};
+        data_ = static_cast<char*>(region_.get_address()) + RingDataOffset;
+
+        std::memcpy(header_->magic, RingMagic, sizeof header_->magic);
+        header_->capacity = capacity_;
+        header_->state.store(RingState::open, std::memory_order_release);
+    }
+
+    RingFrameSink(const RingFrameSink&) = delete;
+    RingFrameSink& operator=(const RingFrameSink&) = delete;
+
+    ~RingFrameSink() override
+    {
+        // Do not leave the consumer waiting if the extraction failed
+        finish();
+    }
+
+    void write(const FrameHeader& header, const cv::Mat& patch) override
+    {
+        const std::uint64_t frameSize = alignedFrameSize(header.size);
+
+        if (frameSize > capacity_) {
+            throw std::invalid_argument{"the ring buffer is too small for a single patch"};
+        }
+
+        std::scoped_lock lock{mutex_};
+
+        const std::uint64_t head = header_->head.load(std::memory_order_relaxed);
+        const std::uint64_t offset = head % capacity_;
+        // Frames are contiguous. Skip the end of the data area if necessary.
+        const std::uint64_t skip = capacity_ - offset < frameSize ? capacity_ - offset : 0;
+
+        waitForSpace(head + skip + frameSize);
+
+        if (skip >= sizeof(FrameHeader)) {
+            FrameHeader wrap{};
+            std::memcpy(wrap.magic, FrameMagic, sizeof wrap.magic);
+            wrap.type = WrapFrameType;
+            wrap.size = skip - sizeof(FrameHeader);
+
+            std::memcpy(data_ + offset, &wrap, sizeof wrap);
+        }
+
+        char* out = data_ + (head + skip) % capacity_;
+        std::memcpy(out, &header, sizeof header);
+        out += sizeof header;
+
+        const std::size_t rowBytes = static_cast<std::size_t>(patch.cols) * patch.elemSize();
+
+        for (int y = 0; y != patch.rows; ++y) {
+            std::memcpy(out + y * rowBytes, patch.ptr(y), rowBytes);
+        }
+
+        header_->head.store(head + skip + frameSize, std::memory_order_release);
+    }
+
+    void finish() noexcept override
+    {
+        header_->state.store(RingState::closed, std::memory_order_release);
+    }
+
+private:
+    // Waits until the consumer released the frames up to the given end
+    // position minus the capacity
+    void waitForSpace(std::uint64_t end) const
+    {
+        for (unsigned spins = 0; end - header_->tail.load(std::memory_order_acquire) > capacity_; ++spins) {
+            if (spins < 64) {
+                std::this_thread::yield();
+            }
+            else {
+                std::this_thread::sleep_for(std::chrono::microseconds{100});
+            }
+        }
+    }
+
+    std::string name_;
+    std::uint64_t capacity_;
+    boost::interprocess::mapped_region region_;
+    RingHeader* header_ = nullptr;
+    char* data_ = nullptr;
+    std::mutex mutex_;
+};
+
+// Passes the patches of a single window to a frame sink shared by all the
+// windows
+class FrameWriter final : public PatchWriter
+{
+public:
+    explicit FrameWriter(std::shared_ptr<FrameSink> sink) noexcept
+        : sink_{std::move(sink)}
+    {
+    }
+
+    void write(const PatchInfo& info, const cv::Mat& patch) override
+    {
+        FrameHeader header{};
+        std::memcpy(header.magic, FrameMagic, sizeof header.magic);
+        header.window = static_cast<std::uint32_t>(info.window);
+        header.index = info.index;
+        header.objectId = info.object.id;
+        header.flags = info.negative ? NegativeFrameFlag : 0;
+        header.variant = static_cast<std::uint32_t>(info.variant);
+        header.rows = patch.rows;
+        header.cols = patch.cols;
+        header.type = patch.type();
+        header.size = patch.total() * patch.elemSize();
+
+        sink_->write(header, patch);
+
+        bytesWritten_.fetch_add(sizeof header + header.size, std::memory_order_relaxed);
+    }
+
+    void finish() override
+    {
+        sink_->finish();
+    }
+
+    [[nodiscard]] std::uintmax_t bytesWritten() const noexcept override
+    {
+        return bytesWritten_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::shared_ptr<FrameSink> sink_;
+    std::atomic<std::uintmax_t> bytesWritten_{0};
+};
+
+} // namespace pav1iet
+
+#endif // PAV1IET_FRAME_WRITER_HPP
@@ -41,34 +41,10 @@
 #include <boost/spirit/home/x3.hpp>
 
 #include "adapted.hpp"
+#include "ast.hpp"
 
 namespace pascal_v1 {
 
-namespace ast {
-
-struct Object
-{
-    unsigned id;
-    std::string name;
-    std::string label;
-    cv::Point centerPoint;
-    cv::Rect boundingBox;
-};
-
-struct Annotations
-{
-    std::filesystem::path imageFileName;
-    cv::Size imageSize;
-    int channels;
-    std::string database;
-    // Objects with ground truth
-    std::vector<std::string> objectNames;
-    cv::Point topLeft;
-    std::vector<Object> objects;
-};
-
-} // namespace ast
-
 using namespace boost::spirit::x3;
 
 const rule<struct Comment> comment = "comment";
@@ -0,0 +1,76 @@
+//
+// pav1iet - PASCAL Annotation Version 1.00 Extractor Tool
+// Copyright (C) 2026 Sergiu Deitsch <sergiu.deitsch@gmail.com>
+//
+// This file is part of pav1iet.
+//
+// pav1iet is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pav1iet is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pav1iet.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef PAV1IET_HASH_HPP
+#define PAV1IET_HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+namespace pav1iet {
+
+// 64-bit FNV-1a hash. Unlike std::hash, the hash values are stable across
+// runs and can be therefore persisted. Integers are hashed in the native byte
+// order.
+class Fnv1a
+{
+public:
+    Fnv1a& update(const void* data, std::size_t size) noexcept
+    {
+        const auto* bytes = static_cast<const unsigned char*>(data);
+
+        for (std::size_t i = 0; i != size; ++i) {
+            state_ = (state_ ^ bytes[i]) * Prime;
+        }
+
+        return *this;
+    }
+
+    Fnv1a& update(std::string_view value) noexcept
+    {
+        // Include the length to separate consecutive strings
+        update(static_cast<std::uint64_t>(value.size()));
+        return update(value.data(), value.size());
+    }
+
+    template<class T>
+        requires std::is_integral_v<T>
+    Fnv1a& update(T value) noexcept
+    {
+        return update(&value, sizeof value);
+    }
+
+    [[nodiscard]] std::uint64_t value() const noexcept
+    {
+        return state_;
+    }
+
+private:
+    static constexpr std::uint64_t OffsetBasis = 14695981039346656037ULL;
+    static constexpr std::uint64_t Prime = 1099511628211ULL;
+
+    std::uint64_t state_ = OffsetBasis;
+};
+
+} // namespace pav1iet
+
+#endif // PAV1IET_HASH_HPP
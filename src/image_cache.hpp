@@ -0,0 +1,399 @@
+//
+// pav1iet - PASCAL Annotation Version 1.00 Extractor Tool
+// Copyright (C) 2026 Sergiu Deitsch <sergiu.deitsch@gmail.com>
+//
+// This file is part of pav1iet.
+//
+// pav1iet is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pav1iet is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pav1iet.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef PAV1IET_IMAGE_CACHE_HPP
+#define PAV1IET_IMAGE_CACHE_HPP
+
+#include <opencv2/core/core.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "hash.hpp"
+
+namespace pav1iet {
+
+// Header of a cached decoded image. The pixels follow at headerSize bytes
+// from the beginning of the file as densely packed rows. The header size is
+// a multiple of 64 such that the pixels can be used directly from a memory
+// mapping of the file.
+struct CachedImageHeader
+{
+    static constexpr char Magic[8] = {'P', 'A', 'V', '1', 'I', 'M', 'G', '\0'};
+    static constexpr std::uint32_t CurrentVersion = 1;
+
+    char magic[8];
+    std::uint32_t version;
+    // Offset of the pixels in bytes
+    std::uint32_t headerSize;
+    std::int32_t rows;
+    std::int32_t cols;
+    // OpenCV type of the pixels, e.g., CV_8UC3
+    std::int32_t type;
+    // cv::imread mode used for decoding
+    std::int32_t mode;
+    // Key of the cache entry
+    std::uint64_t key;
+    std::uint8_t reserved[24];
+};
+
+static_assert(sizeof(CachedImageHeader) == 64);
+
+// Decoded images shared by all the pipeline stages. Concurrent requests for
+// the same image and decode mode are decoded only once. If a cache directory
+// is specified, decoded pixels are additionally persisted in a
+// memory-mappable layout keyed by the image path, its size and its
+// modification time. The least recently used entries are evicted once the
+// cache exceeds its size budget.
+class ImageCache
+{
+public:
+    // Keeps the pixels of a loaded image alive
+    using Handle = std::shared_ptr<const void>;
+
+    ImageCache() = default;
+
+    ImageCache(std::filesystem::path directory, std::uintmax_t budget)
+        : directory_{std::move(directory)}
+        , budget_{budget}
+    {
+        std::filesystem::create_directories(directory_);
+        scan();
+    }
+
+    // Returns the decoded image. The decode function is called with no
+    // arguments only if the image is neither being loaded by another thread
+    // nor cached on disk.
+    template<class Decode>
+    [[nodiscard]] std::pair<cv::Mat, Handle> load(const std::filesystem::path& fileName, int mode, Decode&& decode)
+    {
+        std::shared_ptr<Entry> entry;
+
+        {
+            std::scoped_lock lock{mutex_};
+
+            std::weak_ptr<Entry>& shared = inFlight_[std::format("{}\n{}", fileName.string(), mode)];
+            entry = shared.lock();
+
+            if (!entry) {
+                entry = std::make_shared<Entry>();
+                shared = entry;
+            }
+            else {
+                numShared_.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            if (inFlight_.size() > 2 * numSweep_) {
+                sweep();
+            }
+        }
+
+        // Concurrent loads of the same image wait here. If loading fails,
+        // the next thread retries.
+        std::call_once(entry->once, [this, &entry, &fileName, mode, &decode] {
+            std::optional<std::uint64_t> key;
+
+            if (!directory_.empty()) {
+                key = makeKey(fileName, mode);
+
+                if (key && (entry->region = map(*key, mode, entry->image))) {
+                    numHits_.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+            }
+
+            entry->image = decode();
+
+            if (key && !entry->image.empty()) {
+                numMisses_.fetch_add(1, std::memory_order_relaxed);
+                store(*key, mode, entry->image);
+            }
+        });
+
+        return {entry->image, entry};
+    }
+
+    // Number of images read from the disk cache
+    [[nodiscard]] std::size_t hits() const noexcept
+    {
+        return numHits_.load(std::memory_order_relaxed);
+    }
+
+    // Number of images decoded and added to the disk cache
+    [[nodiscard]] std::size_t misses() const noexcept
+    {
+        return numMisses_.load(std::memory_order_relaxed);
+    }
+
+    // Number of loads that reused an image decoded for another annotation
+    [[nodiscard]] std::size_t shared() const noexcept
+    {
+        return numShared_.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Entry
+    {
+        std::once_flag once;
+        cv::Mat image;
+        // Mapping of the cached pixels
+        std::shared_ptr<boost::interprocess::mapped_region> region;
+    };
+
+    struct Usage
+    {
+        std::string name;
+        std::uintmax_t size;
+    };
+
+    [[nodiscard]] static std::optional<std::uint64_t> makeKey(const std::filesystem::path& fileName, int mode)
+    {
+        std::error_code ec;
+        const std::filesystem::path absolute = std::filesystem::absolute(fileName, ec);
+        const std::uintmax_t size = std::filesystem::file_size(fileName, ec);
+
+        if (ec) {
+            return std::nullopt;
+        }
+
+        const auto modified = std::filesystem::last_write_time(fileName, ec);
+
+        if (ec) {
+            return std::nullopt;
+        }
+
+        return Fnv1a{}
+            .update(absolute.generic_string())
+            .update(size)
+            .update(static_cast<std::int64_t>(modified.time_since_epoch().count()))
+            .update(mode)
+            .value();
+    }
+
+    [[nodiscard]] static std::string entryName(std::uint64_t key)
+    {
+        return std::format("{:016x}.pav1img", key);
+    }
+
+    // Creates the in-memory LRU list from the cache directory contents using
+    // the modification times of the files as the time of last use.
+    void scan()
+    {
+        std::vector<std::pair<std::filesystem::file_time_type, Usage> > files;
+
+        for (const auto& e : std::filesystem::directory_iterator{directory_}) {
+            if (e.is_regular_file() && e.path().extension() == ".pav1img") {
+                files.emplace_back(e.last_write_time(), Usage{e.path().filename().string(), e.file_size()});
+            }
+        }
+
+        std::ranges::sort(files, [] (const auto& a, const auto& b) { return a.first > b.first; });
+
+        for (auto& [time, usage] : files) {
+            totalSize_ += usage.size;
+            std::string name = usage.name;
+            lru_.push_back(std::move(usage));
+            index_.emplace(std::move(name), std::prev(lru_.end()));
+        }
+
+        std::scoped_lock lock{mutex_};
+        evict();
+    }
+
+    [[nodiscard]] std::shared_ptr<boost::interprocess::mapped_region> map(std::uint64_t key, int mode, cv::Mat& image)
+    {
+        namespace bip = boost::interprocess;
+
+        const std::string name = entryName(key);
+        const std::filesystem::path fileName = directory_ / name;
+
+        {
+            std::scoped_lock lock{mutex_};
+
+            const auto pos = index_.find(name);
+
+            if (pos == index_.end()) {
+                return nullptr;
+            }
+
+            // Mark as most recently used
+            lru_.splice(lru_.begin(), lru_, pos->second);
+        }
+
+        std::shared_ptr<bip::mapped_region> region;
+
+        try {
+            const bip::file_mapping mapping{fileName.c_str(), bip::read_only};
+            region = std::make_shared<bip::mapped_region>(mapping, bip::read_only);
+        }
+        catch (const bip::interprocess_exception&) {
+            // Evicted concurrently by another process
+            return nullptr;
+        }
+
+        CachedImageHeader header;
+
+        if (region->get_size() < sizeof header) {
+            return nullptr;
+        }
+
+        std::memcpy(&header, region->get_address(), sizeof header);
+
+        const std::size_t rowBytes = static_cast<std::size_t>(header.cols) * CV_ELEM_SIZE(header.type);
+
+        if (std::memcmp(header.magic, CachedImageHeader::Magic, sizeof header.magic) != 0 ||
+            header.version != CachedImageHeader::CurrentVersion || header.key != key || header.mode != mode ||
+            header.headerSize < sizeof header || header.rows <= 0 || header.cols <= 0 ||
+            region->get_size() < header.headerSize + rowBytes * static_cast<std::size_t>(header.rows)) {
+            return nullptr;
+        }
+
+        // Persist the recency across runs
+        std::error_code ec;
+        std::filesystem::last_write_time(fileName, std::filesystem::file_time_type::clock::now(), ec);
+
+        // The pixels are never modified
+        image = cv::Mat{header.rows, header.cols, header.type,
+                        static_cast<char*>(region->get_address()) + header.headerSize, rowBytes};
+
+        return region;
+    }
+
+    void store(std::uint64_t key, int mode, const cv::Mat& image)
+    {
+        const std::string name = entryName(key);
+        const std::filesystem::path fileName = directory_ / name;
+        // Concurrent writers of the same entry use distinct temporary files
+        const std::filesystem::path tmpFileName = directory_ /
+            std::format("{}.{}.tmp", name, std::hash<std::thread::id>{}(std::this_thread::get_id()));
+
+        CachedImageHeader header{};
+        std::memcpy(header.magic, CachedImageHeader::Magic, sizeof header.magic);
+        header.version = CachedImageHeader::CurrentVersion;
+        header.headerSize = sizeof header;
+        header.rows = image.rows;
+        header.cols = image.cols;
+        header.type = image.type();
+        header.mode = mode;
+        header.key = key;
+
+        const std::size_t rowBytes = static_cast<std::size_t>(image.cols) * image.elemSize();
+
+        {
+            std::ofstream out{tmpFileName, std::ios_base::binary};
+            out.write(reinterpret_cast<const char*>(&header), sizeof header);
+
+            for (int y = 0; y != image.rows; ++y) {
+                out.write(reinterpret_cast<const char*>(image.ptr(y)), static_cast<std::streamsize>(rowBytes));
+            }
+
+            if (!out) {
+                // Caching is optional; do not fail because of a full disk
+                std::error_code ec;
+                std::filesystem::remove(tmpFileName, ec);
+                return;
+            }
+        }
+
+        std::error_code ec;
+        // Atomically publish the entry
+        std::filesystem::rename(tmpFileName, fileName, ec);
+
+        if (ec) {
+            std::filesystem::remove(tmpFileName, ec);
+            return;
+        }
+
+        const std::uintmax_t size = sizeof header + rowBytes * static_cast<std::size_t>(image.rows);
+
+        std::scoped_lock lock{mutex_};
+
+        if (const auto pos = index_.find(name); pos != index_.end()) {
+            totalSize_ -= pos->second->size;
+            lru_.erase(pos->second);
+            index_.erase(pos);
+        }
+
+        lru_.push_front(Usage{name, size});
+        index_.emplace(name, lru_.begin());
+        totalSize_ += size;
+
+        evict();
+    }
+
+    // Removes the least recently used entries until the cache fits into the
+    // budget. Entries that are mapped remain valid until unmapped.
+    void evict()
+    {
+        while (totalSize_ > budget_ && !lru_.empty()) {
+            const Usage& usage = lru_.back();
+
+            std::error_code ec;
+            std::filesystem::remove(directory_ / usage.name, ec);
+
+            totalSize_ -= usage.size;
+            index_.erase(usage.name);
+            lru_.pop_back();
+        }
+    }
+
+    // Drops the bookkeeping of images that are not in use anymore
+    void sweep()
+    {
+        std::erase_if(inFlight_, [] (const auto& value) { return value.second.expired(); });
+        numSweep_ = std::max<std::size_t>(inFlight_.size(), 64);
+    }
+
+    std::filesystem::path directory_;
+    std::uintmax_t budget_ = 0;
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::weak_ptr<Entry> > inFlight_;
+    std::size_t numSweep_ = 64;
+    // Most recently used entries first
+    std::list<Usage> lru_;
+    std::unordered_map<std::string, std::list<Usage>::iterator> index_;
+    std::uintmax_t totalSize_ = 0;
+    std::atomic_size_t numHits_{0};
+    std::atomic_size_t numMisses_{0};
+    std::atomic_size_t numShared_{0};
+};
+
+} // namespace pav1iet
+
+#endif // PAV1IET_IMAGE_CACHE_HPP
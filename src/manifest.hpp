@@ -0,0 +1,275 @@
+//
+// pav1iet - PASCAL Annotation Version 1.00 Extractor Tool
+// Copyright (C) 2026 Sergiu Deitsch <sergiu.deitsch@gmail.com>
+//
+// This file is part of pav1iet.
+//
+// pav1iet is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pav1iet is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pav1iet.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef PAV1IET_MANIFEST_HPP
+#define PAV1IET_MANIFEST_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <ios>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "file_buffer.hpp"
+#include "hash.hpp"
+
+namespace pav1iet {
+
+// Inputs and outputs of a single annotation file
+struct ManifestEntry
+{
+    // Hash of the annotation file contents
+    std::uint64_t annotationHash = 0;
+    // Size and modification time of the referenced image. If both are
+    // unchanged, the image is not hashed again.
+    std::uintmax_t imageSize = 0;
+    std::int64_t imageTime = 0;
+    // Hash of the referenced image file contents
+    std::uint64_t imageHash = 0;
+    // Output indices [firstIndex, firstIndex + count)
+    std::size_t firstIndex = 0;
+    std::size_t count = 0;
+};
+
+[[nodiscard]] inline std::uint64_t hashFileContents(const std::filesystem::path& fileName)
+{
+    const FileBuffer buffer = FileBuffer::map(fileName);
+    return Fnv1a{}.update(buffer.data(), buffer.size()).value();
+}
+
+// Record of the annotation files whose patches have been written completely.
+// Entries are appended to the manifest as soon as an annotation is done such
+// that an interrupted run can be resumed from the last committed annotation.
+// The manifest is valid only for the extraction parameters it was created
+// with; a manifest with different parameters is discarded.
+//
+// The manifest does not assign output indices. It only tells which patches
+// at the indices of the current run are still up to date and which indices
+// written by previous runs are no longer used.
+//
+// The manifest is a tab-separated text file starting with a header line
+// followed by one line per annotation file. Lines not terminated by a newline
+// stem from an interrupted write and are ignored. Later lines supersede
+// earlier ones for the same annotation file. Reservation lines record the
+// output indices a run is about to write such that the patches of files that
+// were not committed before an interruption can still be found.
+class Manifest
+{
+public:
+    Manifest(std::filesystem::path fileName, std::uint64_t parameters)
+        : fileName_{std::move(fileName)}
+        , header_{std::format("# pav1iet manifest {} {:016x}", Version, parameters)}
+    {
+        load();
+
+        if (discarded_ || previous_.empty()) {
+            journal_.open(fileName_, std::ios_base::trunc);
+            journal_ << header_ << '\n';
+        }
+        else {
+            journal_.open(fileName_, std::ios_base::app);
+        }
+
+        if (!journal_.flush()) {
+            throw std::runtime_error{"failed to write " + fileName_.string()};
+        }
+    }
+
+    // Returns the entry recorded by a previous run or nullptr
+    [[nodiscard]] const ManifestEntry* find(const std::filesystem::path& annotationFileName) const
+    {
+        const auto pos = previous_.find(annotationFileName.generic_string());
+        return pos != previous_.end() ? &pos->second : nullptr;
+    }
+
+    // One past the largest output index a previous run may have written
+    [[nodiscard]] std::size_t previousEndIndex() const noexcept
+    {
+        return previousEndIndex_;
+    }
+
+    // Whether an existing manifest was discarded due to different extraction
+    // parameters
+    [[nodiscard]] bool discarded() const noexcept
+    {
+        return discarded_;
+    }
+
+    // Records the annotation file as done. Must be called only after all of
+    // its patches have been written.
+    void commit(const std::filesystem::path& annotationFileName, const ManifestEntry& entry)
+    {
+        const std::string line = format(annotationFileName, entry);
+
+        std::scoped_lock lock{mutex_};
+
+        if (!(journal_ << line).flush()) {
+            throw std::runtime_error{"failed to write " + fileName_.string()};
+        }
+
+        current_.insert_or_assign(annotationFileName.generic_string(), line);
+    }
+
+    // Records that patches up to the given output index are about to be
+    // written. Must be called before the patches are written. The journal is
+    // extended in chunks to keep the number of writes low.
+    void reserve(std::size_t endIndex)
+    {
+        std::scoped_lock lock{mutex_};
+
+        if (endIndex <= reservedEndIndex_) {
+            return;
+        }
+
+        reservedEndIndex_ = endIndex + ReservationChunk;
+
+        if (!(journal_ << std::format("{}{}\n", ReservationPrefix, reservedEndIndex_)).flush()) {
+            throw std::runtime_error{"failed to write " + fileName_.string()};
+        }
+    }
+
+    // Keeps an entry of a previous run for an annotation file that was
+    // skipped because it did not change.
+    void keep(const std::filesystem::path& annotationFileName, const ManifestEntry& entry)
+    {
+        std::string line = format(annotationFileName, entry);
+
+        std::scoped_lock lock{mutex_};
+        current_.insert_or_assign(annotationFileName.generic_string(), std::move(line));
+    }
+
+    // Rewrites the manifest to contain only the entries of the current run
+    // after it completed successfully. Output indices past the end of the
+    // current run are no longer referenced afterwards.
+    void compact()
+    {
+        std::scoped_lock lock{mutex_};
+
+        journal_.close();
+
+        std::filesystem::path tmpFileName = fileName_;
+        tmpFileName += ".tmp";
+
+        {
+            std::ofstream out{tmpFileName, std::ios_base::trunc};
+            out << header_ << '\n';
+
+            for (const auto& [name, line] : current_) {
+                out << line;
+            }
+
+            if (!out.flush()) {
+                throw std::runtime_error{"failed to write " + tmpFileName.string()};
+            }
+        }
+
+        std::filesystem::rename(tmpFileName, fileName_);
+    }
+
+private:
+    static constexpr int Version = 2;
+    static constexpr std::string_view ReservationPrefix = "# reserved ";
+    static constexpr std::size_t ReservationChunk = 1024;
+
+    [[nodiscard]] static std::string format(const std::filesystem::path& annotationFileName,
+                                            const ManifestEntry& entry)
+    {
+        return std::format("{}\t{:016x}\t{}\t{}\t{:016x}\t{}\t{}\n", annotationFileName.generic_string(),
+                           entry.annotationHash, entry.imageSize, entry.imageTime, entry.imageHash,
+                           entry.firstIndex, entry.count);
+    }
+
+    void load()
+    {
+        std::ifstream in{fileName_};
+
+        if (!in) {
+            // First run
+            return;
+        }
+
+        std::string line;
+
+        if (!std::getline(in, line) || line != header_) {
+            discarded_ = true;
+            return;
+        }
+
+        while (std::getline(in, line)) {
+            if (in.eof()) {
+                // Incomplete last line of an interrupted run
+                break;
+            }
+
+            if (line.starts_with(ReservationPrefix)) {
+                std::istringstream fields{line.substr(ReservationPrefix.size())};
+
+                if (std::size_t endIndex; fields >> endIndex) {
+                    previousEndIndex_ = std::max(previousEndIndex_, endIndex);
+                }
+
+                continue;
+            }
+
+            const std::size_t tab = line.find('\t');
+
+            if (tab == std::string::npos) {
+                continue;
+            }
+
+            std::istringstream fields{line.substr(tab + 1)};
+            ManifestEntry entry;
+
+            fields >> std::hex >> entry.annotationHash >> std::dec >> entry.imageSize >> entry.imageTime >>
+                std::hex >> entry.imageHash >> std::dec >> entry.firstIndex >> entry.count;
+
+            if (!fields) {
+                continue;
+            }
+
+            previousEndIndex_ = std::max(previousEndIndex_, entry.firstIndex + entry.count);
+            previous_.insert_or_assign(line.substr(0, tab), entry);
+        }
+    }
+
+    std::filesystem::path fileName_;
+    std::string header_;
+    bool discarded_ = false;
+    std::unordered_map<std::string, ManifestEntry> previous_;
+    std::size_t previousEndIndex_ = 0;
+    std::mutex mutex_;
+    std::size_t reservedEndIndex_ = 0;
+    std::ofstream journal_;
+    // Manifest lines of the current run sorted by the annotation file name
+    std::map<std::string, std::string> current_;
+};
+
+} // namespace pav1iet
+
+#endif // PAV1IET_MANIFEST_HPP
@@ -0,0 +1,159 @@
+//
+// pav1iet - PASCAL Annotation Version 1.00 Extractor Tool
+// Copyright (C) 2026 Sergiu Deitsch <sergiu.deitsch@gmail.com>
+//
+// This file is part of pav1iet.
+//
+// pav1iet is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pav1iet is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pav1iet.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef PAV1IET_MEMORY_BUDGET_HPP
+#define PAV1IET_MEMORY_BUDGET_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+
+namespace pav1iet {
+
+// Bounds the amount of memory held by the items in flight. Items reserve
+// their estimated memory before allocating it and wait until enough of the
+// budget has been released by other items.
+class MemoryBudget
+{
+public:
+    // Releases the reserved memory once destroyed
+    class Reservation
+    {
+    public:
+        Reservation() = default;
+
+        Reservation(Reservation&& other) noexcept
+            : budget_{std::exchange(other.budget_, nullptr)}
+            , bytes_{std::exchange(other.bytes_, 0)}
+        {
+        }
+
+        Reservation& operator=(Reservation&& other) noexcept
+        {
+            if (this != &other) {
+                shrink(0);
+                budget_ = std::exchange(other.budget_, nullptr);
+                bytes_ = std::exchange(other.bytes_, 0);
+            }
+
+            return *this;
+        }
+
+        ~Reservation()
+        {
+            shrink(0);
+        }
+
+        // Returns the memory exceeding the given amount to the budget
+        void shrink(std::uintmax_t bytes) noexcept
+        {
+            if (budget_ != nullptr && bytes < bytes_) {
+                budget_->release(bytes_ - bytes);
+                bytes_ = bytes;
+            }
+        }
+
+        [[nodiscard]] std::uintmax_t size() const noexcept
+        {
+            return bytes_;
+        }
+
+    private:
+        friend class MemoryBudget;
+
+        Reservation(MemoryBudget& budget, std::uintmax_t bytes) noexcept
+            : budget_{&budget}
+            , bytes_{bytes}
+        {
+        }
+
+        MemoryBudget* budget_ = nullptr;
+        std::uintmax_t bytes_ = 0;
+    };
+
+    // A limit of zero disables the budget.
+    explicit MemoryBudget(std::uintmax_t limit = 0) noexcept
+        : limit_{limit}
+    {
+    }
+
+    MemoryBudget(const MemoryBudget&) = delete;
+    MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+    [[nodiscard]] bool enabled() const noexcept
+    {
+        return limit_ != 0;
+    }
+
+    // Blocks until the memory fits into the budget. A reservation larger
+    // than the whole budget is granted once no other memory is reserved.
+    [[nodiscard]] Reservation reserve(std::uintmax_t bytes)
+    {
+        if (!enabled()) {
+            return Reservation{};
+        }
+
+        std::unique_lock lock{mutex_};
+
+        released_.wait(lock, [this, bytes] {
+            return used_ == 0 || used_ + bytes <= limit_;
+        });
+
+        used_ += bytes;
+        peak_ = std::max(peak_, used_);
+
+        return Reservation{*this, bytes};
+    }
+
+    [[nodiscard]] std::uintmax_t limit() const noexcept
+    {
+        return limit_;
+    }
+
+    // Largest amount of memory reserved at the same time
+    [[nodiscard]] std::uintmax_t peak() const
+    {
+        std::scoped_lock lock{mutex_};
+        return peak_;
+    }
+
+private:
+    void release(std::uintmax_t bytes) noexcept
+    {
+        {
+            std::scoped_lock lock{mutex_};
+            used_ -= bytes;
+        }
+
+        released_.notify_all();
+    }
+
+    std::uintmax_t limit_;
+    mutable std::mutex mutex_;
+    std::condition_variable released_;
+    std::uintmax_t used_ = 0;
+    std::uintmax_t peak_ = 0;
+};
+
+} // namespace pav1iet
+
+#endif // PAV1IET_MEMORY_BUDGET_HPP
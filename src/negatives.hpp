@@ -0,0 +1,99 @@
+//
+// pav1iet - PASCAL Annotation Version 1.00 Extractor Tool
+// Copyright (C) 2026 Sergiu Deitsch <sergiu.deitsch@gmail.com>
+//
+// This file is part of pav1iet.
+//
+// pav1iet is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pav1iet is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pav1iet.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef PAV1IET_NEGATIVES_HPP
+#define PAV1IET_NEGATIVES_HPP
+
+#include <opencv2/core/core.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <random>
+
+#include "crop.hpp"
+#include "random.hpp"
+
+namespace pav1iet {
+
+// Intersection of two rectangles relative to the smaller one. Unlike the
+// intersection over union, it approaches one both for a window that contains
+// an object and for a window inside an object no matter how much their sizes
+// differ.
+[[nodiscard]] inline double overlap(const cv::Rect& a, const cv::Rect& b)
+{
+    const double intersection = (a & b).area();
+    const double smaller = std::min(a.area(), b.area());
+
+    if (smaller > 0) {
+        return intersection / smaller;
+    }
+
+    // Degenerate boxes are covered if they lie within the other rectangle
+    return a.contains(b.tl()) || b.contains(a.tl()) ? 1 : 0;
+}
+
+// Samples up to count windows at random positions and scales that overlap
+// none of the objects' bounding boxes by more than maxOverlap. The overlap is
+// measured relative to the smaller of the window and the box, so that a large
+// window around a small object is rejected as well. The windows are at least
+// as large as the window size such that they are never upsampled. Fewer
+// windows are returned if the image is too small or too crowded.
+template<class Objects, class Crops>
+void sampleNegatives(const cv::Size& imageSize, const Objects& objects, const cv::Size& windowSize,
+                     std::size_t count, double maxOverlap, std::mt19937_64& rng, Crops& crops)
+{
+    const double maxScale = std::min(static_cast<double>(imageSize.width) / windowSize.width,
+                                     static_cast<double>(imageSize.height) / windowSize.height);
+
+    if (count == 0 || !(maxScale >= 1)) {
+        return;
+    }
+
+    // Give up on crowded images eventually
+    const std::size_t maxAttempts = 100 * count;
+    const std::size_t first = crops.size();
+
+    for (std::size_t attempt = 0; attempt != maxAttempts && crops.size() - first != count; ++attempt) {
+        // Log-uniform scale to sample each octave equally often
+        const double scale = std::exp(uniform(rng, 0, std::log(maxScale)));
+
+        const cv::Size size{std::min(static_cast<int>(std::lround(windowSize.width * scale)), imageSize.width),
+                            std::min(static_cast<int>(std::lround(windowSize.height * scale)), imageSize.height)};
+        const cv::Point tl{static_cast<int>(uniform(rng, 0, imageSize.width - size.width + 1)),
+                           static_cast<int>(uniform(rng, 0, imageSize.height - size.height + 1))};
+        const cv::Rect rect{tl, size};
+
+        const bool background = std::ranges::none_of(objects, [&rect, maxOverlap] (const auto& object) {
+            return overlap(rect, object.boundingBox) > maxOverlap;
+        });
+
+        if (background) {
+            const cv::Point2f center{static_cast<float>(rect.x) + static_cast<float>(rect.width) / 2.0f,
+                                     static_cast<float>(rect.y) + static_cast<float>(rect.height) / 2.0f};
+            crops.push_back(Crop{center, size});
+        }
+    }
+}
+
+} // namespace pav1iet
+
+#endif // PAV1IET_NEGATIVES_HPP
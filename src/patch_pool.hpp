@@ -0,0 +1,183 @@
+//
+// pav1iet - PASCAL Annotation Version 1.00 Extractor Tool
+// Copyright (C) 2026 Sergiu Deitsch <sergiu.deitsch@gmail.com>
+//
+// This file is part of pav1iet.
+//
+// pav1iet is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pav1iet is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pav1iet.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef PAV1IET_PATCH_POOL_HPP
+#define PAV1IET_PATCH_POOL_HPP
+
+#include <opencv2/core/core.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include <tbb/concurrent_queue.h>
+
+namespace pav1iet {
+
+// Recycles the pixel buffers of patches. Buffers are carved out of slabs
+// holding many patches each and are returned to the pool once the last
+// cv::Mat referring to them is released. The pool is used by assigning it to
+// cv::Mat::allocator before the matrix is created, e.g., by cv::warpAffine.
+// Matrices larger than the buffer size are allocated on the heap. The pool
+// must outlive all the matrices allocated from it.
+class PatchPool final : public cv::MatAllocator
+{
+public:
+    explicit PatchPool(std::size_t bufferSize, std::size_t buffersPerSlab = 64)
+        : bufferSize_{bufferSize}
+        // Keep the buffers cache line aligned
+        , stride_{(bufferSize + Alignment - 1) / Alignment * Alignment}
+        , buffersPerSlab_{buffersPerSlab}
+    {
+    }
+
+    PatchPool(const PatchPool&) = delete;
+    PatchPool& operator=(const PatchPool&) = delete;
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, std::size_t* step,
+                           cv::AccessFlag /*flags*/, cv::UMatUsageFlags /*usageFlags*/) const override
+    {
+        // Same layout as the default allocator
+        std::size_t total = CV_ELEM_SIZE(type);
+
+        for (int i = dims - 1; i >= 0; --i) {
+            if (step != nullptr) {
+                if (data != nullptr && step[i] != CV_AUTOSTEP) {
+                    total = step[i];
+                }
+                else {
+                    step[i] = total;
+                }
+            }
+
+            total *= static_cast<std::size_t>(sizes[i]);
+        }
+
+        auto u = std::make_unique<cv::UMatData>(this);
+        u->size = total;
+
+        if (data != nullptr) {
+            u->data = u->origdata = static_cast<uchar*>(data);
+            u->flags |= cv::UMatData::USER_ALLOCATED;
+        }
+        else if (total > bufferSize_) {
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            u->data = u->origdata = static_cast<uchar*>(cv::fastMalloc(total));
+        }
+        else {
+            u->data = u->origdata = acquire();
+        }
+
+        return u.release();
+    }
+
+    bool allocate(cv::UMatData* data, cv::AccessFlag /*flags*/, cv::UMatUsageFlags /*usageFlags*/) const override
+    {
+        return data != nullptr;
+    }
+
+    void deallocate(cv::UMatData* data) const override
+    {
+        if (data == nullptr) {
+            return;
+        }
+
+        if ((data->flags & cv::UMatData::USER_ALLOCATED) == 0) {
+            if (data->size > bufferSize_) {
+                cv::fastFree(data->origdata);
+            }
+            else {
+                free_.push(data->origdata);
+            }
+        }
+
+        delete data;
+    }
+
+    // Number of buffers that were recycled
+    [[nodiscard]] std::size_t hits() const noexcept
+    {
+        return hits_.load(std::memory_order_relaxed);
+    }
+
+    // Number of buffers that had to be allocated
+    [[nodiscard]] std::size_t misses() const noexcept
+    {
+        return misses_.load(std::memory_order_relaxed);
+    }
+
+    // Total size of the slabs in bytes
+    [[nodiscard]] std::size_t capacity() const
+    {
+        std::scoped_lock lock{mutex_};
+        return slabs_.size() * buffersPerSlab_ * stride_;
+    }
+
+private:
+    static constexpr std::size_t Alignment = 64;
+
+    struct Free
+    {
+        void operator()(uchar* p) const noexcept
+        {
+            ::operator delete(p, std::align_val_t{Alignment});
+        }
+    };
+
+    [[nodiscard]] uchar* acquire() const
+    {
+        uchar* buffer;
+
+        if (free_.try_pop(buffer)) {
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return buffer;
+        }
+
+        misses_.fetch_add(1, std::memory_order_relaxed);
+
+        std::scoped_lock lock{mutex_};
+
+        auto& slab = slabs_.emplace_back(
+            static_cast<uchar*>(::operator new(buffersPerSlab_ * stride_, std::align_val_t{Alignment})));
+
+        // The first buffer is handed out directly
+        for (std::size_t i = 1; i < buffersPerSlab_; ++i) {
+            free_.push(slab.get() + i * stride_);
+        }
+
+        return slab.get();
+    }
+
+    std::size_t bufferSize_;
+    std::size_t stride_;
+    std::size_t buffersPerSlab_;
+    mutable tbb::concurrent_queue<uchar*> free_;
+    mutable std::mutex mutex_;
+    mutable std::vector<std::unique_ptr<uchar[], Free> > slabs_;
+    mutable std::atomic_size_t hits_{0};
+    mutable std::atomic_size_t misses_{0};
+};
+
+} // namespace pav1iet
+
+#endif // PAV1IET_PATCH_POOL_HPP
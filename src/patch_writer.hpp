@@ -0,0 +1,160 @@
+//
+// pav1iet - PASCAL Annotation Version 1.00 Extractor Tool
+// Copyright (C) 2026 Sergiu Deitsch <sergiu.deitsch@gmail.com>
+//
+// This file is part of pav1iet.
+//
+// pav1iet is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pav1iet is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pav1iet.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef PAV1IET_PATCH_WRITER_HPP
+#define PAV1IET_PATCH_WRITER_HPP
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgcodecs/imgcodecs.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <boost/format.hpp>
+
+#include <pav1iet/extractor.hpp>
+
+namespace pav1iet {
+
+// Destination of the patches of a single window
+class PatchWriter
+{
+public:
+    virtual ~PatchWriter() = default;
+
+    // Called concurrently for patches in arbitrary order
+    virtual void write(const PatchInfo& info, const cv::Mat& patch) = 0;
+
+    // Called once after all the patches have been written successfully
+    virtual void finish()
+    {
+    }
+
+    // Deletes the patch with the given output index left over from a
+    // previous run. Returns whether a patch was deleted. Writers that do not
+    // store the patches separately ignore the call.
+    virtual bool remove(std::size_t /*index*/)
+    {
+        return false;
+    }
+
+    // Total size of the output written so far
+    [[nodiscard]] virtual std::uintmax_t bytesWritten() const noexcept = 0;
+};
+
+// Turns the output file name pattern into a format with exactly one
+// placeholder. Patterns without a placeholder are used as a prefix followed
+// by the index and the extension.
+[[nodiscard]] inline boost::format makeFileNameFormat(const std::filesystem::path& pattern,
+                                                      const std::string& extension)
+{
+    boost::format fmt{pattern.string()};
+
+    if (fmt.expected_args() == 0) {
+        return boost::format{pattern.string() + "%1%" + extension};
+    }
+
+    if (fmt.expected_args() > 1) {
+        throw std::invalid_argument{"output file name format must contain exactly one placeholder"};
+    }
+
+    return fmt;
+}
+
+// Encodes each patch into a separate image file
+class ImageFileWriter final : public PatchWriter
+{
+public:
+    // The codec is the file extension (without the dot) of the image encoder.
+    // If empty, the encoder is determined from the output file name.
+    ImageFileWriter(const std::filesystem::path& pattern, const std::string& codec,
+                    std::vector<int> encodeParams)
+        : extension_{codec.empty() ? ".png" : "." + codec}
+        , fileNameFormat_{makeFileNameFormat(pattern, extension_)}
+        , encodeParams_{std::move(encodeParams)}
+    {
+        if (codec.empty() && fileNameFormat_.expected_args() == 1 && pattern.has_extension()) {
+            extension_ = pattern.extension().string();
+        }
+
+        if (!cv::haveImageWriter(extension_)) {
+            throw std::invalid_argument{"no image encoder available for " + extension_ + " files"};
+        }
+    }
+
+    void write(const PatchInfo& info, const cv::Mat& patch) override
+    {
+        boost::format fmt = fileNameFormat_;
+        const std::string fileName = str(fmt % info.index);
+
+        std::vector<uchar> encoded;
+
+        if (!cv::imencode(extension_, patch, encoded, encodeParams_)) {
+            throw std::runtime_error{"failed to encode " + fileName};
+        }
+
+        std::ofstream out{fileName, std::ios_base::binary};
+
+        if (!out.write(reinterpret_cast<const char*>(encoded.data()),
+                       static_cast<std::streamsize>(encoded.size()))) {
+            throw std::runtime_error{"failed to write " + fileName};
+        }
+
+        bytesWritten_.fetch_add(encoded.size(), std::memory_order_relaxed);
+    }
+
+    bool remove(std::size_t index) override
+    {
+        boost::format fmt = fileNameFormat_;
+        const std::string fileName = str(fmt % index);
+
+        std::error_code ec;
+        const bool removed = std::filesystem::remove(fileName, ec);
+
+        if (ec) {
+            throw std::runtime_error{"failed to remove " + fileName};
+        }
+
+        return removed;
+    }
+
+    [[nodiscard]] std::uintmax_t bytesWritten() const noexcept override
+    {
+        return bytesWritten_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::string extension_;
+    boost::format fileNameFormat_;
+    std::vector<int> encodeParams_;
+    std::atomic<std::uintmax_t> bytesWritten_{0};
+};
+
+} // namespace pav1iet
+
+#endif // PAV1IET_PATCH_WRITER_HPP
@@ -19,40 +19,367 @@
 //
 
 #include <opencv2/imgcodecs/imgcodecs.hpp>
-#include <opencv2/imgproc/imgproc.hpp>
 
-#include <atomic>
-#include <cassert>
-#include <chrono>
-#include <condition_variable>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
 #include <filesystem>
 #include <format>
 #include <fstream>
+#include <functional>
 #include <iostream>
-#include <mutex>
-#include <stop_token>
-#include <thread>
-#include <tuple>
-
-// Enable for debugging purposes
-// #define BOOST_SPIRIT_X3_DEBUG
-#define BOOST_SPIRIT_X3_UNICODE
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include <boost/format.hpp>
-#include <boost/fusion/adapted/std_tuple.hpp>
 #include <boost/program_options.hpp>
-#include <boost/scope_exit.hpp>
-#include <boost/spirit/home/support/iterators/istream_iterator.hpp>
-#include <boost/spirit/home/x3.hpp>
-#include <boost/spirit/home/x3/support/utility/utf8.hpp>
 
-#include <tbb/parallel_pipeline.h>
+#include <pav1iet/extractor.hpp>
 
-#include "grammar.hpp"
+#include "byte_size.hpp"
+#include "frame_writer.hpp"
+#include "hash.hpp"
+#include "patch_writer.hpp"
+#include "shard_writer.hpp"
 
 namespace {
 
+using pav1iet::AnnotationInput;
+using pav1iet::AnnotationParser;
+using pav1iet::CropKernel;
+using pav1iet::IoEngine;
+using pav1iet::PixelFormat;
+
+enum class PngStrategy
+{
+    default_ = cv::IMWRITE_PNG_STRATEGY_DEFAULT,
+    filtered = cv::IMWRITE_PNG_STRATEGY_FILTERED,
+    huffman = cv::IMWRITE_PNG_STRATEGY_HUFFMAN_ONLY,
+    rle = cv::IMWRITE_PNG_STRATEGY_RLE,
+    fixed = cv::IMWRITE_PNG_STRATEGY_FIXED
+};
+
+std::istream& operator>>(std::istream& in, PngStrategy& value)
+{
+    std::string token;
+    in >> token;
+
+    if (token == "default") {
+        value = PngStrategy::default_;
+    }
+    else if (token == "filtered") {
+        value = PngStrategy::filtered;
+    }
+    else if (token == "huffman") {
+        value = PngStrategy::huffman;
+    }
+    else if (token == "rle") {
+        value = PngStrategy::rle;
+    }
+    else if (token == "fixed") {
+        value = PngStrategy::fixed;
+    }
+    else {
+        in.setstate(std::ios_base::failbit);
+    }
+
+    return in;
+}
+
+// Specifies how patches are stored
+enum class OutputFormat
+{
+    // One encoded image file per patch
+    image,
+    // Raw patches packed into memory-mappable shard files
+    shard,
+    // Framed raw patches written to standard output
+    stream,
+    // Framed raw patches passed through a shared memory ring buffer
+    shm
+};
+
+std::istream& operator>>(std::istream& in, OutputFormat& value)
+{
+    std::string token;
+    in >> token;
+
+    if (token == "image") {
+        value = OutputFormat::image;
+    }
+    else if (token == "shard") {
+        value = OutputFormat::shard;
+    }
+    else if (token == "stream") {
+        value = OutputFormat::stream;
+    }
+    else if (token == "shm") {
+        value = OutputFormat::shm;
+    }
+    else {
+        in.setstate(std::ios_base::failbit);
+    }
+
+    return in;
+}
+
+std::ostream& operator<<(std::ostream& out, OutputFormat value)
+{
+    switch (value) {
+        case OutputFormat::image:
+            return out << "image";
+        case OutputFormat::shard:
+            return out << "shard";
+        case OutputFormat::stream:
+            return out << "stream";
+        case OutputFormat::shm:
+            return out << "shm";
+    }
+
+    return out;
+}
+
+// Detection window whose patches are written to a separate output
+struct WindowSpec : pav1iet::Window
+{
+    // Output file name pattern
+    std::filesystem::path output;
+};
+
+// Parses <W>x<H>[,<P>][:<pattern>]. The padding applies horizontally only
+// since the vertical padding follows from the aspect ratio of the window.
+std::istream& operator>>(std::istream& in, WindowSpec& value)
+{
+    std::string token;
+    std::getline(in, token);
+
+    std::istringstream spec{token.substr(0, token.find(':'))};
+    char x;
+
+    if (!(spec >> value.windowSize.width >> x >> value.windowSize.height) || x != 'x' ||
+        value.windowSize.width <= 0 || value.windowSize.height <= 0) {
+        in.setstate(std::ios_base::failbit);
+        return in;
+    }
+
+    if (char comma; spec >> comma) {
+        if (comma != ',' || !(spec >> value.padding) || value.padding < 0 || !(spec >> std::ws).eof()) {
+            in.setstate(std::ios_base::failbit);
+            return in;
+        }
+    }
+    else {
+        // Keep the padding proportional to the default 64x128 window
+        value.padding = value.windowSize.width / 4;
+    }
+
+    if (const std::size_t pos = token.find(':'); pos != std::string::npos) {
+        value.output = token.substr(pos + 1);
+    }
+
+    return in;
+}
+
+// Per-channel statistic given either once for all the channels or as
+// <B>,<G>,<R>
+struct ChannelValues
+{
+    cv::Scalar value;
+};
+
+std::istream& operator>>(std::istream& in, ChannelValues& value)
+{
+    std::string token;
+    in >> token;
+
+    std::istringstream spec{token};
+    double values[3];
+
+    if (!(spec >> values[0])) {
+        in.setstate(std::ios_base::failbit);
+        return in;
+    }
+
+    if (char comma; spec >> comma) {
+        if (comma != ',' || !(spec >> values[1] >> comma >> values[2]) || comma != ',' ||
+            !(spec >> std::ws).eof()) {
+            in.setstate(std::ios_base::failbit);
+            return in;
+        }
+    }
+    else {
+        values[1] = values[2] = values[0];
+    }
+
+    value.value = cv::Scalar{values[0], values[1], values[2]};
+
+    return in;
+}
+
+struct Options
+{
+    AnnotationInput annotationInput = AnnotationInput::map;
+    AnnotationParser annotationParser = AnnotationParser::x3;
+    // Parse each annotation file using both parsers and compare the results
+    bool verifyParser = false;
+    // Zero means unlimited
+    std::ptrdiff_t maxConcurrentReads = 0;
+    IoEngine ioEngine = IoEngine::sync;
+    std::size_t readAhead = 16;
+    // File extension (without the dot) of the image encoder. If empty, the
+    // encoder is determined from the output file name.
+    std::string codec;
+    // Negative values use the encoder default
+    int pngCompression = -1;
+    std::optional<PngStrategy> pngStrategy;
+    // Decode images at the coarsest resolution that avoids upsampling
+    bool reducedDecode = false;
+    CropKernel cropKernel = CropKernel::warp;
+    // Maximum absolute difference between the patches of both crop kernels
+    std::optional<double> verifyCropKernel;
+    PixelFormat pixelFormat = PixelFormat::bgr8;
+    std::optional<pav1iet::Normalization> normalization;
+    // Patches extracted from each image
+    std::vector<WindowSpec> windows;
+    pav1iet::NegativeSampling negatives;
+    // Output file name patterns of the negative windows of each window
+    std::vector<std::filesystem::path> negativeOutputs;
+    pav1iet::Augmentation augmentation;
+    std::uint64_t seed = 0;
+    OutputFormat outputFormat = OutputFormat::image;
+    std::size_t patchesPerShard = 4096;
+    // Name of the shared memory object of the ring buffer
+    std::string ringName;
+    pav1iet::ByteSize ringSize{std::uintmax_t{64} << 20};
+    // Tar archive the files are read from. Disabled if empty.
+    std::filesystem::path archive;
+    // Directory of the persistent decoded image cache. Disabled if empty.
+    std::filesystem::path imageCache;
+    pav1iet::ByteSize imageCacheSize{std::uintmax_t{4} << 30};
+    // Manifest of a resumable extraction. Disabled if empty.
+    std::filesystem::path manifest;
+    // Print per-stage pipeline statistics
+    bool stats = false;
+    // Chrome trace event file of the pipeline stages. Disabled if empty.
+    std::filesystem::path trace;
+    // Maximum memory held by decoded images and patches. Zero means
+    // unlimited.
+    pav1iet::ByteSize memoryBudget;
+    // Maximum number of annotation files in flight. Zero selects a default
+    // based on the number of cores.
+    std::size_t maxTokens = 0;
+    // Process the most expensive images first
+    bool largestFirst = false;
+};
+
+// Creates the writers of the patches of each window or of their negative
+// windows
+[[nodiscard]] std::vector<std::unique_ptr<pav1iet::PatchWriter> > makeWriters(const Options& options,
+                                                                              bool negatives)
+{
+    std::vector<int> encodeParams;
+
+    if (options.pngCompression >= 0) {
+        encodeParams.insert(encodeParams.end(), {cv::IMWRITE_PNG_COMPRESSION, options.pngCompression});
+    }
+
+    if (options.pngStrategy) {
+        encodeParams.insert(encodeParams.end(), {cv::IMWRITE_PNG_STRATEGY, static_cast<int>(*options.pngStrategy)});
+    }
+
+    std::vector<std::unique_ptr<pav1iet::PatchWriter> > writers;
+    writers.reserve(options.windows.size());
+
+    // The frames of all the windows are interleaved
+    std::shared_ptr<pav1iet::FrameSink> sink;
+
+    if (options.outputFormat == OutputFormat::stream) {
+        sink = std::make_shared<pav1iet::StreamFrameSink>(stdout);
+    }
+    else if (options.outputFormat == OutputFormat::shm) {
+        sink = std::make_shared<pav1iet::RingFrameSink>(options.ringName, options.ringSize.value);
+    }
+
+    for (std::size_t i = 0; i != options.windows.size(); ++i) {
+        const WindowSpec& window = options.windows[i];
+        const std::filesystem::path& output = negatives ? options.negativeOutputs[i] : window.output;
+
+        switch (options.outputFormat) {
+            case OutputFormat::image:
+                writers.push_back(std::make_unique<pav1iet::ImageFileWriter>(output, options.codec, encodeParams));
+                break;
+            case OutputFormat::shard:
+                writers.push_back(std::make_unique<pav1iet::ShardWriter>(output, options.patchesPerShard,
+                                                                         window.windowSize,
+                                                                         pav1iet::patchType(options.pixelFormat)));
+                break;
+            case OutputFormat::stream:
+            case OutputFormat::shm:
+                writers.push_back(std::make_unique<pav1iet::FrameWriter>(sink));
+                break;
+        }
+    }
+
+    return writers;
+}
+
+// Hash of the output options that affect the stored patches
+[[nodiscard]] std::uint64_t outputParametersHash(const Options& options)
+{
+    pav1iet::Fnv1a hash;
+
+    for (const WindowSpec& window : options.windows) {
+        hash.update(window.output.generic_string());
+    }
+
+    hash.update(static_cast<int>(options.outputFormat))
+        .update(options.codec)
+        .update(options.pngCompression)
+        .update(options.pngStrategy ? static_cast<int>(*options.pngStrategy) : -1);
+
+    return hash.value();
+}
+
+[[nodiscard]] pav1iet::ExtractorOptions makeExtractorOptions(const Options& options)
+{
+    pav1iet::ExtractorOptions result;
+
+    result.annotationInput = options.annotationInput;
+    result.annotationParser = options.annotationParser;
+    result.verifyParser = options.verifyParser;
+    result.maxConcurrentReads = options.maxConcurrentReads;
+    result.ioEngine = options.ioEngine;
+    result.readAhead = options.readAhead;
+    result.reducedDecode = options.reducedDecode;
+    result.cropKernel = options.cropKernel;
+    result.verifyCropKernel = options.verifyCropKernel;
+    result.pixelFormat = options.pixelFormat;
+    result.normalization = options.normalization;
+    result.windows.assign(options.windows.begin(), options.windows.end());
+    result.negatives = options.negatives;
+    result.augmentation = options.augmentation;
+    result.seed = options.seed;
+    result.archive = options.archive;
+    result.imageCache = options.imageCache;
+    result.imageCacheSize = options.imageCacheSize.value;
+    result.manifest = options.manifest;
+    result.consumerParametersHash = outputParametersHash(options);
+    result.stats = options.stats;
+    result.trace = options.trace;
+    result.memoryBudget = options.memoryBudget.value;
+    result.maxTokens = options.maxTokens;
+    result.largestFirst = options.largestFirst;
+    result.progress = &std::clog;
+
+    return result;
+}
+
 constexpr const char* const banner =
     "PASCAL Annotation Version 1.00 Image Extraction Tool\n"
     "Copyright (C) 2026 Sergiu Deitsch\n"
@@ -85,347 +412,167 @@ void version()
     std::cout << banner;
 }
 
-int processListing(std::istream& in, const std::filesystem::path& directory,
-                   const std::filesystem::path& outBaseFileName)
+// Runs the extraction on the input of the given function
+using Run = std::function<pav1iet::ExtractionSummary(pav1iet::Extractor& extractor,
+                                                     const pav1iet::PatchConsumer& consumer)>;
+
+int extract(const Options& options, const Run& run)
 {
-    std::atomic_size_t emptyDescCount{0};
-    std::atomic_size_t failCount{0};
-    std::atomic_size_t numProcessedFiles{0};
-    std::atomic_size_t numTotalFiles{0};
-    std::atomic_size_t numObjects{0};
-    std::atomic_size_t numWrittenImages{0};
-    std::condition_variable_any update;
-    std::mutex updateMonitor;
-
-    // Progress report thread
-    std::jthread t
-    (
-        [&numProcessedFiles, &numTotalFiles, &numObjects, &update, &updateMonitor] (std::stop_token token)
-        {
-            BOOST_SCOPE_EXIT(void)
-            {
-                std::clog << '\r' << '\n';
-            }
-            BOOST_SCOPE_EXIT_END
-
-            {
-                // Wait until the first line in the annotations listing has been
-                // read.
-                std::unique_lock lock{updateMonitor};
-                update.wait(lock, token, [&numTotalFiles] {
-                    return numTotalFiles.load(std::memory_order_relaxed) != 0;
-                });
-            }
+    std::vector<std::unique_ptr<pav1iet::PatchWriter> > writers;
+    std::vector<std::unique_ptr<pav1iet::PatchWriter> > negativeWriters;
+    std::optional<pav1iet::Extractor> extractor;
 
-            while (!token.stop_requested()) {
-                // The acquire load of processed synchronizes with the mutex
-                // unlock in processObjects, making numTotalFiles >=
-                // numProcessedFiles visible by the time total is read.
-                const std::size_t processed = numProcessedFiles.load(std::memory_order_acquire);
-                const std::size_t total = numTotalFiles.load(std::memory_order_relaxed);
-                const std::size_t percent = processed * 100 / total;
-
-                std::clog << '\r';
-                std::clog << std::format(
-                    "processed {0} out of {1} annotations ({3} objects) ({2}% "
-                    "done)",
-                    processed, total, percent,
-                    numObjects.load(std::memory_order_relaxed));
-
-                if (percent >= 100) {
-                    break;
-                }
-
-                {
-                    using namespace std::chrono_literals;
-                    constexpr auto UpdateInterval = 500ms;
-
-                    // Reduce the update rate
-                    std::unique_lock lock{updateMonitor};
-                    update.wait_for(
-                        lock, token, UpdateInterval, [processed, &numProcessedFiles] {
-                            return processed != numProcessedFiles.load(
-                                                    std::memory_order_relaxed);
-                        });
-                }
-            }
-        }
-    );
-
-    const auto readFileName = tbb::make_filter<void, std::filesystem::path>
-    (
-        tbb::filter_mode::serial_out_of_order,
-        [source = t.get_stop_source(), &update, &in, &numTotalFiles, directory, &updateMonitor] (tbb::flow_control& fc)
-        {
-            std::string fileName;
-
-            if (!std::getline(in, fileName)) {
-                fc.stop();
-
-                if (numTotalFiles.load(std::memory_order_relaxed) == 0) {
-                    // In case no files could be read, directly notify the progress
-                    // report thread to avoid a dead lock.
-                    source.request_stop();
-                }
-            }
-            else {
-              const bool start = [&numTotalFiles, &updateMonitor] {
-                // Ensure to update numTotalFiles to avoid lost notification
-                std::scoped_lock lock{updateMonitor};
-                return numTotalFiles.fetch_add(1, std::memory_order_relaxed) ==
-                       0;
-              }();
-
-              if (start) {
-                // Start updating the progress
-                update.notify_one();
-              }
-            }
+    try {
+        writers = makeWriters(options, false);
 
-            return directory / fileName;
+        // Frames of negative windows are written to the same sink and are
+        // marked by NegativeFrameFlag
+        if (options.negatives.count != 0 && options.outputFormat != OutputFormat::stream &&
+            options.outputFormat != OutputFormat::shm) {
+            negativeWriters = makeWriters(options, true);
         }
-    );
-
-    // Read in the annotations
-    const auto loadAnnotations = tbb::make_filter<std::filesystem::path, std::tuple<std::filesystem::path, pascal_v1::ast::Annotations> >
-    (
-        tbb::filter_mode::serial_out_of_order,
-        [] (const std::filesystem::path& fileName)
-        {
-            namespace x3 = boost::spirit::x3;
-
-            std::ifstream in{fileName};
-            in.unsetf(std::ios_base::skipws);
-
-            pascal_v1::ast::Annotations annotations;
-
-            // clang-format off
-            bool parsed = x3::phrase_parse
-            (
-                  boost::spirit::istream_iterator{in}
-                , boost::spirit::istream_iterator{}
-                , pascal_v1::annotation >> x3::eoi
-                , x3::unicode::space
-                , annotations
-            );
-            // clang-format on
-
-            if (!parsed) {
-                throw std::runtime_error{"failed to parse annotations in " + fileName.string()};
-            }
 
-            return std::make_tuple(fileName, annotations);
-        }
-    );
-
-    // Load images
-    const auto loadImages = tbb::make_filter
-    <
-          std::tuple<std::filesystem::path, pascal_v1::ast::Annotations>
-        , std::tuple<std::filesystem::path, pascal_v1::ast::Annotations, cv::Mat>
-    >
-    (
-        tbb::filter_mode::serial_out_of_order,
-        [&numObjects, directory] (const std::tuple<std::filesystem::path, pascal_v1::ast::Annotations>& t)
-        {
-            const auto& annotations = std::get<pascal_v1::ast::Annotations>(t);
-            const std::filesystem::path imageFileName = directory / annotations.imageFileName;
-
-            cv::Mat image = cv::imread(imageFileName);
-
-            if (image.empty()) {
-                throw std::invalid_argument{"failed to read image " + imageFileName.string()};
-            }
+        extractor.emplace(makeExtractorOptions(options));
 
-            numObjects.fetch_add(annotations.objects.size(), std::memory_order_relaxed);
+        if (extractor->manifestDiscarded()) {
+            std::clog << "extraction parameters changed; ignoring " << options.manifest << std::endl;
+        }
 
-            return std::tuple_cat(t, std::make_tuple(image));
+        if (const std::string_view reason = extractor->ioEngineFallback(); !reason.empty()) {
+            std::clog << reason << "; reading files on threads instead" << std::endl;
         }
-    );
-
-    const auto processObjects = tbb::make_filter
-    <
-          std::tuple<std::filesystem::path, pascal_v1::ast::Annotations, cv::Mat>
-        , std::vector<cv::Mat>
-    >
-    (
-        tbb::filter_mode::parallel,
-        [&numProcessedFiles, &update, &updateMonitor] (const std::tuple<std::filesystem::path, pascal_v1::ast::Annotations, cv::Mat>& t)
-        {
-            const auto& annotations = std::get<pascal_v1::ast::Annotations>(t);
-            const cv::Mat& image = std::get<cv::Mat>(t);
-
-            std::vector<cv::Mat> croppedImages;
-            croppedImages.reserve(annotations.objects.size());
-
-            const cv::Size windowSize{64, 128};
-            const cv::Size padding{16, 16}; // one side
-            const cv::Size padding2 = padding * 2; // all four sides
-
-            for (const auto& object : annotations.objects) {
-                cv::Mat patch;
-
-                const cv::Rect rect = object.boundingBox;
-                const cv::Point2f center = (rect.tl() + rect.br()) / 2.0f;
-
-                cv::Size size = rect.size();
-
-                cv::Size size1 = size;
-                size1.height = size.width * windowSize.height / windowSize.width;
-
-                cv::Size size2 = size;
-                size2.width = size.height * windowSize.width / windowSize.height;
-
-                assert(size1.height / size1.width == 2);
-                assert(size2.height / size2.width == 2);
-
-                // Compare ratios using integer arithmetic
-                // i/j > k/l <=> il > kj
-                const int ratio1 = size1.width * windowSize.height - size1.height * windowSize.width;
-
-                // Use the ratio-corrected image (with the larger area)
-                if (ratio1 < 0) {
-                    assert(size1.area() >= size2.area());
-                    size = size1;
-                }
-                else {
-                    size = size2;
-                }
-
-                // Workout how much padding do we need to add to the original
-                // bounding box such that we obtain the desired padding in the
-                // resized image.
-                cv::Size extraPadding2;
-                extraPadding2.width = size.width * padding2.width / windowSize.width;
-                extraPadding2.height = extraPadding2.width * windowSize.height / windowSize.width;
-
-                cv::Size newSize = size + extraPadding2;
-
-                int y = static_cast<int>(center.y);
-
-                int topOverflow = y - newSize.height / 2;
-                int bottomOverflow = image.rows - (y + newSize.height / 2);
-
-                if (topOverflow < 0 || bottomOverflow < 0) {
-                    // Cannot add sufficient vertical padding at the top/bottom
-                    int paddingV = topOverflow < 0
-                                       ? rect.y
-                                       : image.rows - (rect.y + rect.height);
-
-                    newSize.height = size.height + paddingV * 2;
-                    // Account for added vertical padding
-                    newSize.width =
-                        newSize.height * windowSize.width / windowSize.height;
-                }
-
-                cv::Matx33f scale = cv::Matx33f::eye();
-                scale(0, 0) = static_cast<float>(windowSize.width) /
-                              static_cast<float>(newSize.width);
-                scale(1, 1) = static_cast<float>(windowSize.height) /
-                              static_cast<float>(newSize.height);
-
-                cv::Matx33f translate = cv::Matx33f::eye();
-                translate(0, 2) = -(center.x - static_cast<float>(newSize.width) / 2.0f);
-                translate(1, 2) = -(center.y - static_cast<float>(newSize.height) / 2.0f);
-
-                cv::Matx33f tmp = scale * translate;
-                // Take the two top rows.
-                cv::Mat1f M(2, 3, tmp.val);
-
-                // In case we are downsampling, avoid antialiasing.
-                cv::InterpolationFlags flags =
-                    newSize.area() > windowSize.area() ? cv::INTER_AREA
-                                                       : cv::INTER_CUBIC;
-                cv::warpAffine(image, patch, M, windowSize, flags,
-                               cv::BORDER_REFLECT);
-
-                croppedImages.push_back(std::move(patch));
-            }
+    }
+    catch (const std::invalid_argument& e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    catch (const std::runtime_error& e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
 
-            {
-                std::scoped_lock lock{updateMonitor};
-                numProcessedFiles.fetch_add(1, std::memory_order_relaxed);
-            }
+    std::size_t failCount = 0;
+    std::size_t numRemoved = 0;
+    pav1iet::ExtractionSummary summary;
 
-            // Update notifying update to limit the update rate
+    try {
+        summary = run(*extractor, [&writers, &negativeWriters] (const pav1iet::PatchInfo& info, const cv::Mat& patch) {
+            (info.negative && !negativeWriters.empty() ? negativeWriters : writers)[info.window]->write(info, patch);
+        });
 
-            return croppedImages;
+        for (const auto& writer : writers) {
+            writer->finish();
         }
-    );
 
-    boost::format outFileNameFmt;
+        for (const auto& writer : negativeWriters) {
+            writer->finish();
+        }
 
-    if (boost::format tmp{outBaseFileName.string()}; tmp.expected_args() == 0) {
-        outFileNameFmt = boost::format{outBaseFileName.string() + "%1%.png"};
+        // Patches of removed annotation files or of a previous numbering
+        for (const auto& writer : writers) {
+            for (std::size_t index = summary.firstStaleIndex; index != summary.endStaleIndex; ++index) {
+                numRemoved += writer->remove(index);
+            }
+        }
     }
-    else if (tmp.expected_args() > 1) {
-        std::cerr << "error: output file name format must contain exactly one placeholder" << std::endl;
+    catch (const std::exception& e) {
+        std::cerr << "error: " << e.what() << std::endl;
         return EXIT_FAILURE;
     }
-    else {
-        outFileNameFmt = std::move(tmp);
-    }
-
-    const auto writePatches = tbb::make_filter
-    <
-          std::vector<cv::Mat>
-        , void
-    >
-    (
-        tbb::filter_mode::serial_in_order,
-        [&numWrittenImages, outFileNameFmt] (const std::vector<cv::Mat>& croppedImages)
-        {
-            boost::format fmt = outFileNameFmt;
-
-            for (const cv::Mat& image : croppedImages) {
-                cv::imwrite(str(fmt % numWrittenImages.fetch_add(1, std::memory_order_relaxed)), image);
-            }
+
+    if (summary.numPatches > 0 && options.outputFormat == OutputFormat::stream) {
+        std::clog << std::format("wrote {} patches to standard output", summary.numPatches) << std::endl;
+    }
+    else if (summary.numPatches > 0 && options.outputFormat == OutputFormat::shm) {
+        std::clog << std::format("wrote {} patches to shared memory object {}", summary.numPatches,
+                                 options.ringName)
+                  << std::endl;
+    }
+    else if (summary.numPatches > 0) {
+        // Each window yields the same number of patches
+        const std::size_t numWindowImages = (summary.numPatches - summary.numNegatives) / options.windows.size();
+
+        for (const WindowSpec& window : options.windows) {
+            const std::filesystem::path tmp = window.output.parent_path();
+
+            std::clog << std::format(
+                             "wrote {} {} to {}",
+                             numWindowImages,
+                             options.outputFormat == OutputFormat::image ? "images" : "patches",
+                             (tmp.empty() ? std::filesystem::current_path() : tmp)
+                                 .string())
+                      << std::endl;
         }
-    );
+    }
 
-    try {
-        tbb::parallel_pipeline
-        (
-              std::thread::hardware_concurrency()
-            , readFileName
-            & loadAnnotations
-            & loadImages
-            & processObjects
-            & writePatches
-        );
-
-        // Wait until the progress report thread exists
-        t.join();
+    if (summary.numNegatives > 0) {
+        std::clog << std::format("sampled {} negative windows", summary.numNegatives) << std::endl;
     }
-    catch (const std::exception& e) {
-        t.request_stop();
-        t.join();
 
-        std::cerr << "error: " << e.what() << std::endl;
-        return EXIT_FAILURE;
+    if (options.stats) {
+        std::uintmax_t bytesWritten = 0;
+
+        for (const auto& writer : writers) {
+            bytesWritten += writer->bytesWritten();
+        }
+
+        for (const auto& writer : negativeWriters) {
+            bytesWritten += writer->bytesWritten();
+        }
+
+        extractor->printStatistics(std::clog, bytesWritten);
     }
 
-    if (numWrittenImages.load(std::memory_order_relaxed) > 0) {
-        const std::filesystem::path tmp = outBaseFileName.parent_path();
+    if (summary.numSkippedFiles > 0) {
+        std::clog << std::format("skipped {} unchanged annotations", summary.numSkippedFiles) << std::endl;
+    }
+
+    if (numRemoved > 0) {
+        std::clog << std::format("removed {} stale patches", numRemoved) << std::endl;
+    }
 
-        std::clog << std::format(
-                         "wrote {} images to {}",
-                         numWrittenImages.load(std::memory_order_relaxed),
-                         (tmp.empty() ? std::filesystem::current_path() : tmp)
-                             .string())
+    if (!options.imageCache.empty()) {
+        std::clog << std::format("image cache: {} hits, {} misses", summary.imageCacheHits,
+                                 summary.imageCacheMisses)
                   << std::endl;
     }
 
-    if (in.bad()) {
+    return failCount == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int processListing(std::istream& in, const std::filesystem::path& directory,
+                   const Options& options)
+{
+    const int result = extract(options, [&in, &directory] (pav1iet::Extractor& extractor,
+                                                           const pav1iet::PatchConsumer& consumer) {
+        return extractor.run(in, directory, consumer);
+    });
+
+    if (result == EXIT_SUCCESS && in.bad()) {
         std::cerr << "error: an error occured while reading from input" << std::endl;
         return EXIT_FAILURE;
     }
 
-    //if (emptyDescCount > 0) {
-    //    std::clog << boost::format("warning: omitted %1% empty descriptor files") % emptyDescCount << std::endl;
-    //}
+    return result;
+}
 
-    return failCount == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+// Processes a listing stored in the archive
+int processArchiveListing(const std::filesystem::path& fileName, const std::filesystem::path& directory,
+                          const Options& options)
+{
+    return extract(options, [&fileName, &directory] (pav1iet::Extractor& extractor,
+                                                     const pav1iet::PatchConsumer& consumer) {
+        std::istringstream in{std::string{extractor.archiveMember(fileName)}};
+        return extractor.run(in, directory, consumer);
+    });
+}
+
+int processDirectories(const pav1iet::DirectoryScan& scan, const std::filesystem::path& root,
+                       const Options& options)
+{
+    return extract(options, [&scan, &root] (pav1iet::Extractor& extractor, const pav1iet::PatchConsumer& consumer) {
+        return extractor.run(scan, root, consumer);
+    });
 }
 
 } // namespace
@@ -438,10 +585,108 @@ int main(int argc, char** argv)
 
     std::filesystem::path fileName;
     std::filesystem::path outBaseFileName;
+    pav1iet::DirectoryScan scan;
+    std::filesystem::path root = std::filesystem::current_path();
+    Options options;
 
     opts.add_options()
         ("input,i", (po::value(&fileName))->value_name("<file>"), "annotations list file name")
         ("output,o", (po::value(&outBaseFileName))->value_name("<file>"), "output base file name")
+        ("scan", (po::value(&scan.directories)->composing())->value_name("<dir>"),
+            "process the annotation files found by recursively scanning the directory instead of a listing; "
+            "can be repeated")
+        ("scan-pattern", (po::value(&scan.pattern)->default_value(scan.pattern))->value_name("<glob>"),
+            "file name pattern of the scanned annotation files")
+        ("sort", (po::bool_switch(&scan.sorted)),
+            "process the scanned annotation files in lexicographical order to keep the output numbering stable "
+            "across runs at the expense of waiting for the scan to finish")
+        ("root", (po::value(&root))->value_name("<dir>"),
+            "directory the image file names of scanned annotations are relative to (default current directory); "
+            "together with --archive, the archive directory the listed annotation files are relative to "
+            "(default the directory of the listing)")
+        ("archive", (po::value(&options.archive))->value_name("<file>"),
+            "read the listing, the annotations and the images from the members of an uncompressed tar archive "
+            "instead of unpacking it")
+        ("window,w", (po::value(&options.windows)->composing())->value_name("<spec>"),
+            "detection window size with optional padding and output file name pattern "
+            "given as <W>x<H>[,<P>][:<pattern>] where <P> is the horizontal padding on each side and the vertical "
+            "padding follows from the aspect ratio; can be repeated (default 64x128,16)")
+        ("annotation-input", (po::value(&options.annotationInput)->default_value(options.annotationInput))->value_name("<mode>"),
+            "how annotation files are read before parsing (stream, read, mmap)")
+        ("parser", (po::value(&options.annotationParser)->default_value(options.annotationParser))->value_name("<parser>"),
+            "annotation parser implementation (x3, fast)")
+        ("verify-parser", (po::bool_switch(&options.verifyParser)),
+            "fail if the annotation parsers disagree")
+        ("max-concurrent-reads", (po::value(&options.maxConcurrentReads)->default_value(options.maxConcurrentReads))->value_name("<n>"),
+            "maximum number of files read at the same time (0 for unlimited)")
+        ("io-engine", (po::value(&options.ioEngine)->default_value(options.ioEngine))->value_name("<engine>"),
+            "how files are read: blocking reads on the pipeline threads (sync), ahead of the pipeline on "
+            "dedicated threads (threads), or batched using io_uring (uring, falls back to threads)")
+        ("read-ahead", (po::value(&options.readAhead)->default_value(options.readAhead))->value_name("<n>"),
+            "number of annotation files read ahead of the pipeline by the threads and uring engines")
+        ("codec", (po::value(&options.codec))->value_name("<ext>"),
+            "image encoder to use (e.g., png, bmp, tiff); defaults to the output file extension")
+        ("png-compression", (po::value(&options.pngCompression))->value_name("<level>"),
+            "PNG compression level between 0 (fastest) and 9 (smallest)")
+        ("png-strategy", (po::value<PngStrategy>()->notifier([&options] (PngStrategy value) { options.pngStrategy = value; }))->value_name("<strategy>"),
+            "PNG compression strategy (default, filtered, huffman, rle, fixed)")
+        ("reduced-decode", (po::bool_switch(&options.reducedDecode)),
+            "decode images at a reduced resolution if all the objects are downsampled")
+        ("crop-kernel", (po::value(&options.cropKernel)->default_value(options.cropKernel))->value_name("<kernel>"),
+            "patch extraction implementation (warp, separable)")
+        ("verify-crop-kernel", (po::value<double>()->implicit_value(2.0)->notifier([&options] (double value) { options.verifyCropKernel = value; }))->value_name("<tolerance>"),
+            "fail if the separable crop kernel deviates from cv::warpAffine by more than the tolerance")
+        ("pixel-format", (po::value(&options.pixelFormat)->default_value(options.pixelFormat))->value_name("<format>"),
+            "pixels of the patches: 8-bit BGR (bgr8) or grayscale (gray8), or floating point values in [0, 1] "
+            "(bgr32f, gray32f)")
+        ("mean", (po::value<ChannelValues>())->value_name("<m>[,<m>,<m>]"),
+            "subtract the per-channel mean from floating point patches")
+        ("std", (po::value<ChannelValues>())->value_name("<s>[,<s>,<s>]"),
+            "divide floating point patches by the per-channel standard deviation after subtracting the mean")
+        ("output-format", (po::value(&options.outputFormat)->default_value(options.outputFormat))->value_name("<format>"),
+            "store each patch in a separate image file (image), pack raw patches into shards (shard), "
+            "write framed raw patches to standard output (stream), or pass them through a shared memory "
+            "ring buffer named by the output base file name (shm)")
+        ("negatives", (po::value(&options.negatives.count)->default_value(options.negatives.count))->value_name("<n>"),
+            "number of negative windows sampled at random positions and scales from each image")
+        ("negative-overlap", (po::value(&options.negatives.maxOverlap)->default_value(options.negatives.maxOverlap))->value_name("<ratio>"),
+            "maximum intersection of a negative window with any of the annotated bounding boxes relative to the "
+            "smaller of the two; windows that contain a whole object or lie within one are always rejected "
+            "unless the ratio is 1")
+        ("negative-output", (po::value(&options.negativeOutputs)->composing())->value_name("<pattern>"),
+            "output file name pattern of the negative windows; must be repeated for each window")
+        ("flip", (po::bool_switch(&options.augmentation.flip)),
+            "additionally extract the mirror image of each patch")
+        ("jitter", (po::value(&options.augmentation.jitter)->default_value(options.augmentation.jitter))->value_name("<n>"),
+            "number of randomly translated and scaled copies of each patch")
+        ("jitter-translation", (po::value(&options.augmentation.translation)->default_value(options.augmentation.translation))->value_name("<pixels>"),
+            "maximum translation of the copies in window pixels")
+        ("jitter-scale", (po::value(&options.augmentation.scale)->default_value(options.augmentation.scale))->value_name("<ratio>"),
+            "maximum relative scale change of the copies (e.g., 0.1)")
+        ("seed", (po::value(&options.seed)->default_value(options.seed))->value_name("<n>"),
+            "seed of the negative window sampling and the augmentation")
+        ("shard-size", (po::value(&options.patchesPerShard)->default_value(options.patchesPerShard))->value_name("<n>"),
+            "number of patches per shard")
+        ("ring-size", (po::value(&options.ringSize)->default_value(options.ringSize))->value_name("<size>"),
+            "size of the shared memory ring buffer (e.g., 64M)")
+        ("manifest", (po::value(&options.manifest))->value_name("<file>"),
+            "record the processed annotations to skip unchanged ones in subsequent runs and to resume interrupted runs")
+        ("stats", (po::bool_switch(&options.stats)),
+            "print the time spent in each pipeline stage and the amount of data read and written")
+        ("trace", (po::value(&options.trace))->value_name("<file>"),
+            "write the pipeline stage invocations as Chrome trace events to be viewed in Perfetto")
+        ("image-cache", (po::value(&options.imageCache))->value_name("<dir>"),
+            "directory for caching decoded images across runs")
+        ("image-cache-size", (po::value(&options.imageCacheSize)->default_value(options.imageCacheSize))->value_name("<size>"),
+            "maximum size of the image cache (e.g., 512M, 4G)")
+        ("memory-budget", (po::value(&options.memoryBudget)->default_value(options.memoryBudget))->value_name("<size>"),
+            "maximum memory held by decoded images and their patches (e.g., 2G; 0 for unlimited)")
+        ("largest-first", (po::bool_switch(&options.largestFirst)),
+            "parse all the annotations up front and process the images in decreasing order of their estimated "
+            "cost; the output numbering is not affected")
+        ("max-tokens", (po::value(&options.maxTokens)->default_value(options.maxTokens))->value_name("<n>"),
+            "maximum number of annotation files processed at the same time "
+            "(0 for the number of cores, or four times as many with a memory budget)")
         ("version,v", "show version information")
         ("help,h", "show this help message")
         ;
@@ -473,20 +718,125 @@ int main(int argc, char** argv)
 
     po::notify(vars);
 
-    if (fileName.empty()) {
-        if (outBaseFileName.empty()) {
-            std::cerr << "error: you must provide the output base file name" << std::endl;
-            return EXIT_FAILURE;
+    if (vars.count("png-compression") != 0u && (options.pngCompression < 0 || options.pngCompression > 9)) {
+        std::cerr << "error: PNG compression level must be between 0 and 9" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (options.annotationInput == AnnotationInput::stream &&
+        (options.annotationParser == AnnotationParser::fast || options.verifyParser)) {
+        std::cerr << "error: the fast annotation parser requires the annotations to be read or mapped" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (vars.count("mean") != 0u || vars.count("std") != 0u) {
+        pav1iet::Normalization& normalization = options.normalization.emplace();
+
+        if (vars.count("mean") != 0u) {
+            normalization.mean = vars["mean"].as<ChannelValues>().value;
         }
 
-        // Read from stdin
-        return processListing(std::cin, std::filesystem::current_path(), outBaseFileName);
+        if (vars.count("std") != 0u) {
+            normalization.std = vars["std"].as<ChannelValues>().value;
+        }
+    }
+
+    const bool floatingPoint = CV_MAT_DEPTH(pav1iet::patchType(options.pixelFormat)) == CV_32F;
+
+    if (options.normalization && !floatingPoint) {
+        std::cerr << "error: normalization requires a floating point pixel format" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (floatingPoint && options.outputFormat == OutputFormat::image) {
+        std::cerr << "error: floating point pixel formats require a raw output format" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!options.manifest.empty() && options.outputFormat != OutputFormat::image) {
+        std::cerr << "error: a manifest can be used only together with the image output format" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (options.negatives.count != 0 && !options.manifest.empty()) {
+        std::cerr << "error: negative windows cannot be sampled together with a manifest" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!scan.directories.empty() && !fileName.empty()) {
+        std::cerr << "error: an annotations list cannot be used together with scanning directories" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!options.archive.empty() && !scan.directories.empty()) {
+        std::cerr << "error: directories cannot be scanned within an archive" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!options.archive.empty() && (!options.manifest.empty() || !options.imageCache.empty() ||
+                                     options.ioEngine != IoEngine::sync)) {
+        std::cerr << "error: an archive cannot be combined with a manifest, an image cache or an asynchronous "
+                     "I/O engine" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (options.windows.empty()) {
+        options.windows.emplace_back();
+    }
+
+    // Frames are not written to files
+    const bool framed = options.outputFormat == OutputFormat::stream || options.outputFormat == OutputFormat::shm;
+
+    if (fileName.empty() && outBaseFileName.empty() && options.outputFormat != OutputFormat::stream &&
+        (options.outputFormat == OutputFormat::shm ||
+         std::ranges::any_of(options.windows, [] (const WindowSpec& window) { return window.output.empty(); }))) {
+        std::cerr << "error: you must provide the output base file name" << std::endl;
+        return EXIT_FAILURE;
     }
 
     if (outBaseFileName.empty()) {
         outBaseFileName = fileName.filename().replace_extension();
     }
 
+    for (WindowSpec& window : options.windows) {
+        if (window.output.empty() && !framed) {
+            if (options.windows.size() > 1) {
+                std::cerr << "error: each of the multiple windows requires its own output file name pattern" << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            window.output = outBaseFileName;
+        }
+    }
+
+    if (options.negatives.count != 0 && !framed && options.negativeOutputs.size() != options.windows.size()) {
+        std::cerr << "error: each window requires its own negative window output file name pattern" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    options.ringName = outBaseFileName.filename().string();
+
+    if (!scan.directories.empty()) {
+        return processDirectories(scan, root, options);
+    }
+
+    if (!options.archive.empty()) {
+        // Listed files are relative to the directory of the listing within
+        // the archive. A listing read from stdin refers to the archive root.
+        const std::filesystem::path directory = vars.count("root") != 0u ? root : fileName.parent_path();
+
+        if (fileName.empty()) {
+            return processListing(std::cin, directory, options);
+        }
+
+        return processArchiveListing(fileName, directory, options);
+    }
+
+    if (fileName.empty()) {
+        // Read from stdin
+        return processListing(std::cin, std::filesystem::current_path(), options);
+    }
+
     std::ifstream in{fileName};
 
     if (!in) {
@@ -494,5 +844,5 @@ int main(int argc, char** argv)
         return EXIT_FAILURE;
     }
 
-    return processListing(in, fileName.parent_path(), outBaseFileName);
+    return processListing(in, fileName.parent_path(), options);
 }
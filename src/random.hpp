@@ -0,0 +1,56 @@
+//
+// pav1iet - PASCAL Annotation Version 1.00 Extractor Tool
+// Copyright (C) 2026 Sergiu Deitsch <sergiu.deitsch@gmail.com>
+//
+// This file is part of pav1iet.
+//
+// pav1iet is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pav1iet is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pav1iet.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef PAV1IET_RANDOM_HPP
+#define PAV1IET_RANDOM_HPP
+
+#include <cstdint>
+#include <random>
+
+#include "hash.hpp"
+
+namespace pav1iet {
+
+// Generator whose state depends only on the seed and the values identifying
+// what is being sampled, e.g., the image file name. The samples are therefore
+// independent of the order the images are processed in.
+template<class... Keys>
+[[nodiscard]] std::mt19937_64 makeGenerator(std::uint64_t seed, const Keys&... keys)
+{
+    Fnv1a hash;
+    hash.update(seed);
+    (hash.update(keys), ...);
+
+    return std::mt19937_64{hash.value()};
+}
+
+// Uniformly distributed value in [a, b). Unlike
+// std::uniform_real_distribution, the values are the same for all standard
+// library implementations.
+[[nodiscard]] inline double uniform(std::mt19937_64& rng, double a, double b)
+{
+    const double unit = static_cast<double>(rng() >> 11) * 0x1.0p-53;
+    return a + (b - a) * unit;
+}
+
+} // namespace pav1iet
+
+#endif // PAV1IET_RANDOM_HPP
@@ -0,0 +1,75 @@
+//
+// pav1iet - PASCAL Annotation Version 1.00 Extractor Tool
+// Copyright (C) 2026 Sergiu Deitsch <sergiu.deitsch@gmail.com>
+//
+// This file is part of pav1iet.
+//
+// pav1iet is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pav1iet is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pav1iet.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef PAV1IET_READ_LIMITER_HPP
+#define PAV1IET_READ_LIMITER_HPP
+
+#include <cstddef>
+#include <memory>
+#include <semaphore>
+#include <utility>
+
+namespace pav1iet {
+
+// Bounds the number of file reads that are in progress at the same time
+// independently from the number of threads that decode the data afterwards.
+// This allows to avoid overloading slow (network) file systems without
+// throttling CPU-bound stages.
+class ReadLimiter
+{
+public:
+    // A limit of zero disables throttling.
+    explicit ReadLimiter(std::ptrdiff_t maxConcurrentReads = 0)
+    {
+        if (maxConcurrentReads > 0) {
+            semaphore_ = std::make_unique<std::counting_semaphore<> >(maxConcurrentReads);
+        }
+    }
+
+    // Invokes the read operation once a read slot becomes available.
+    template<class Read>
+    decltype(auto) operator()(Read&& read) const
+    {
+        if (!semaphore_) {
+            return std::forward<Read>(read)();
+        }
+
+        semaphore_->acquire();
+
+        struct Release
+        {
+            ~Release()
+            {
+                semaphore.release();
+            }
+
+            std::counting_semaphore<>& semaphore;
+        } release{*semaphore_};
+
+        return std::forward<Read>(read)();
+    }
+
+private:
+    std::unique_ptr<std::counting_semaphore<> > semaphore_;
+};
+
+} // namespace pav1iet
+
+#endif // PAV1IET_READ_LIMITER_HPP
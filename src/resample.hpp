@@ -0,0 +1,270 @@
+//
+// pav1iet - PASCAL Annotation Version 1.00 Extractor Tool
+// Copyright (C) 2026 Sergiu Deitsch <sergiu.deitsch@gmail.com>
+//
+// This file is part of pav1iet.
+//
+// pav1iet is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pav1iet is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pav1iet.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef PAV1IET_RESAMPLE_HPP
+#define PAV1IET_RESAMPLE_HPP
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+namespace pav1iet {
+
+// Checks whether the transformation consists of a scale and a translation
+// only, i.e., whether the rows and the columns of the destination image can be
+// resampled independently.
+[[nodiscard]] inline bool isAxisAligned(const cv::Matx23f& M) noexcept
+{
+    return M(0, 1) == 0 && M(1, 0) == 0 && M(0, 0) != 0 && M(1, 1) != 0;
+}
+
+namespace detail {
+
+// Precision of the source coordinates used by cv::warpAffine
+constexpr int InterpolationBits = 5;
+constexpr int InterpolationTableSize = 1 << InterpolationBits;
+constexpr int AffineBits = 10;
+constexpr int AffineScale = 1 << AffineBits;
+
+// Source pixels and their weights contributing to each destination pixel
+// along one axis.
+struct Taps
+{
+    // Number of taps per destination pixel
+    int count;
+    std::vector<int> indices;
+    std::vector<float> weights;
+};
+
+inline void interpolationWeights(int fraction, int count, float* weights) noexcept
+{
+    const float t = static_cast<float>(fraction) / InterpolationTableSize;
+
+    if (count == 2) {
+        weights[0] = 1.0f - t;
+        weights[1] = t;
+        return;
+    }
+
+    // Keys cubic convolution with the same coefficient as OpenCV
+    constexpr float A = -0.75f;
+
+    weights[0] = ((A * (t + 1) - 5 * A) * (t + 1) + 8 * A) * (t + 1) - 4 * A;
+    weights[1] = ((A + 2) * t - (A + 3)) * t * t + 1;
+    weights[2] = ((A + 2) * (1 - t) - (A + 3)) * (1 - t) * (1 - t) + 1;
+    weights[3] = 1.0f - weights[0] - weights[1] - weights[2];
+}
+
+// Computes the taps for the fixed-point source coordinates, which are
+// expressed in 1/InterpolationTableSize pixel units.
+template<class Coordinate>
+[[nodiscard]] Taps makeTaps(int length, int sourceLength, int count, Coordinate&& coordinate)
+{
+    Taps taps{count, std::vector<int>(static_cast<std::size_t>(length * count)),
+              std::vector<float>(static_cast<std::size_t>(length * count))};
+
+    // The first tap is located one pixel before the interpolated position in
+    // case of bicubic interpolation.
+    const int first = count == 4 ? -1 : 0;
+
+    for (int i = 0; i != length; ++i) {
+        const int fixed = coordinate(i);
+        const int pos = fixed >> InterpolationBits;
+
+        for (int k = 0; k != count; ++k) {
+            taps.indices[i * count + k] =
+                cv::borderInterpolate(pos + first + k, sourceLength, cv::BORDER_REFLECT);
+        }
+
+        interpolationWeights(fixed & (InterpolationTableSize - 1), count, &taps.weights[i * count]);
+    }
+
+    return taps;
+}
+
+// Stores the resampled value v of channel c as v * alpha[c] + beta[c] using
+// the destination depth U
+template<class T, class U>
+void resample(const cv::Mat& src, cv::Mat& dst, const Taps& horizontal, const Taps& vertical,
+              const cv::Scalar& alpha, const cv::Scalar& beta)
+{
+    const int cn = src.channels();
+    const int rowLength = dst.cols * cn;
+
+    // Horizontally resample each source row referenced by the vertical taps
+    // exactly once.
+    std::vector<int> slots(static_cast<std::size_t>(src.rows), -1);
+    int numSlots = 0;
+
+    for (int index : vertical.indices) {
+        if (slots[index] == -1) {
+            slots[index] = numSlots++;
+        }
+    }
+
+    std::vector<float> rows(static_cast<std::size_t>(numSlots) * rowLength);
+
+    for (int y = 0; y != src.rows; ++y) {
+        if (slots[y] == -1) {
+            continue;
+        }
+
+        const T* const in = src.ptr<T>(y);
+        float* const out = &rows[static_cast<std::size_t>(slots[y]) * rowLength];
+
+        for (int x = 0; x != dst.cols; ++x) {
+            const int* const indices = &horizontal.indices[x * horizontal.count];
+            const float* const weights = &horizontal.weights[x * horizontal.count];
+
+            for (int c = 0; c != cn; ++c) {
+                float sum = 0;
+
+                for (int k = 0; k != horizontal.count; ++k) {
+                    sum += weights[k] * static_cast<float>(in[indices[k] * cn + c]);
+                }
+
+                out[x * cn + c] = sum;
+            }
+        }
+    }
+
+    // The vertical pass combines contiguous rows and therefore vectorizes
+    // well.
+    std::vector<float> acc(static_cast<std::size_t>(rowLength));
+    // Conversion coefficients of each row element
+    std::vector<float> scale(static_cast<std::size_t>(rowLength));
+    std::vector<float> offset(static_cast<std::size_t>(rowLength));
+
+    for (int j = 0; j != rowLength; ++j) {
+        scale[j] = static_cast<float>(alpha[j % cn]);
+        offset[j] = static_cast<float>(beta[j % cn]);
+    }
+
+    for (int y = 0; y != dst.rows; ++y) {
+        std::fill(acc.begin(), acc.end(), 0.0f);
+
+        for (int k = 0; k != vertical.count; ++k) {
+            const float w = vertical.weights[y * vertical.count + k];
+            const float* const row =
+                &rows[static_cast<std::size_t>(slots[vertical.indices[y * vertical.count + k]]) * rowLength];
+
+            for (int j = 0; j != rowLength; ++j) {
+                acc[j] += w * row[j];
+            }
+        }
+
+        U* const out = dst.ptr<U>(y);
+
+        for (int j = 0; j != rowLength; ++j) {
+            out[j] = cv::saturate_cast<U>(acc[j] * scale[j] + offset[j]);
+        }
+    }
+}
+
+template<class T>
+void resample(const cv::Mat& src, cv::Mat& dst, const Taps& horizontal, const Taps& vertical,
+              const cv::Scalar& alpha, const cv::Scalar& beta)
+{
+    if (dst.depth() == src.depth()) {
+        resample<T, T>(src, dst, horizontal, vertical, alpha, beta);
+    }
+    else if (dst.depth() == CV_32F) {
+        resample<T, float>(src, dst, horizontal, vertical, alpha, beta);
+    }
+    else {
+        throw std::invalid_argument{"unsupported destination depth"};
+    }
+}
+
+} // namespace detail
+
+// Equivalent of cv::warpAffine with cv::BORDER_REFLECT for transformations
+// that are axis-aligned (see isAxisAligned). The source coordinates are
+// computed and quantized exactly like cv::warpAffine does. Since the
+// transformation is separable, the interpolation weights are computed once
+// per destination row and column instead of once per pixel. Like
+// cv::warpAffine, cv::INTER_AREA falls back to bilinear interpolation.
+//
+// The resampled values v of each channel c can be converted to v * alpha[c] +
+// beta[c] of the given depth, e.g., CV_32F, while they are being stored,
+// which avoids a separate pass over the patch.
+inline void resampleAxisAligned(const cv::Mat& src, cv::Mat& dst, const cv::Matx23f& M,
+                                const cv::Size& dsize, int interpolation, int depth,
+                                const cv::Scalar& alpha, const cv::Scalar& beta)
+{
+    if (!isAxisAligned(M)) {
+        throw std::invalid_argument{"the transformation is not axis-aligned"};
+    }
+
+    // Invert the transformation the same way cv::invertAffineTransform does
+    const double m00 = M(0, 0);
+    const double m11 = M(1, 1);
+    const double D = 1.0 / (m00 * m11);
+    const double a11 = m11 * D;
+    const double a22 = m00 * D;
+    const double b1 = -a11 * M(0, 2);
+    const double b2 = -a22 * M(1, 2);
+
+    constexpr int roundDelta = detail::AffineScale / detail::InterpolationTableSize / 2;
+    constexpr int shift = detail::AffineBits - detail::InterpolationBits;
+
+    const int count = interpolation == cv::INTER_CUBIC ? 4 : 2;
+
+    const int X0 = static_cast<int>(std::lrint(b1 * detail::AffineScale)) + roundDelta;
+    const detail::Taps horizontal = detail::makeTaps(
+        dsize.width, src.cols, count, [X0, a11] (int x) {
+            return (X0 + static_cast<int>(std::lrint(a11 * x * detail::AffineScale))) >> shift;
+        });
+    const detail::Taps vertical = detail::makeTaps(
+        dsize.height, src.rows, count, [a22, b2] (int y) {
+            return (static_cast<int>(std::lrint((a22 * y + b2) * detail::AffineScale)) + roundDelta) >> shift;
+        });
+
+    dst.create(dsize, CV_MAKETYPE(depth, src.channels()));
+
+    switch (src.depth()) {
+        case CV_8U:
+            detail::resample<uchar>(src, dst, horizontal, vertical, alpha, beta);
+            break;
+        case CV_16U:
+            detail::resample<ushort>(src, dst, horizontal, vertical, alpha, beta);
+            break;
+        case CV_32F:
+            detail::resample<float>(src, dst, horizontal, vertical, alpha, beta);
+            break;
+        default:
+            throw std::invalid_argument{"unsupported image depth"};
+    }
+}
+
+inline void resampleAxisAligned(const cv::Mat& src, cv::Mat& dst, const cv::Matx23f& M,
+                                const cv::Size& dsize, int interpolation)
+{
+    resampleAxisAligned(src, dst, M, dsize, interpolation, src.depth(), cv::Scalar::all(1), cv::Scalar::all(0));
+}
+
+} // namespace pav1iet
+
+#endif // PAV1IET_RESAMPLE_HPP
@@ -0,0 +1,269 @@
+//
+// pav1iet - PASCAL Annotation Version 1.00 Extractor Tool
+// Copyright (C) 2026 Sergiu Deitsch <sergiu.deitsch@gmail.com>
+//
+// This file is part of pav1iet.
+//
+// pav1iet is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pav1iet is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pav1iet.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef PAV1IET_SHARD_WRITER_HPP
+#define PAV1IET_SHARD_WRITER_HPP
+
+#include <opencv2/core/core.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/format.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include "patch_writer.hpp"
+
+namespace pav1iet {
+
+// Header at the beginning of each shard file. All fields are stored in the
+// native byte order. The patches follow the header back to back, each
+// occupying patchSize bytes of densely packed rows. Since the header size is
+// a multiple of 64, the patches can be accessed directly from a memory
+// mapping of the shard.
+struct ShardHeader
+{
+    static constexpr char Magic[8] = {'P', 'A', 'V', '1', 'S', 'H', 'R', 'D'};
+    static constexpr std::uint32_t CurrentVersion = 1;
+
+    char magic[8];
+    std::uint32_t version;
+    // Offset of the first patch in bytes
+    std::uint32_t headerSize;
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t channels;
+    // OpenCV depth of a single channel, e.g., CV_8U
+    std::uint32_t depth;
+    // Number of patches stored in the shard
+    std::uint64_t count;
+    // Size of a single patch in bytes
+    std::uint64_t patchSize;
+    // Output index of the first patch in the shard
+    std::uint64_t firstIndex;
+    std::uint8_t reserved[8];
+};
+
+static_assert(sizeof(ShardHeader) == 64);
+
+// Stores fixed-size patches uncompressed in shards of patchesPerShard
+// patches. Since the output indices are known in advance, the location of
+// each patch is known as well and the patches can be copied into the memory
+// mapped shards concurrently. Next to each shard, a tab-separated table
+// records the origin of each patch.
+class ShardWriter final : public PatchWriter
+{
+public:
+    ShardWriter(const std::filesystem::path& pattern, std::size_t patchesPerShard,
+                const cv::Size& patchSize, int type)
+        : fileNameFormat_{makeFileNameFormat(pattern, ".shard")}
+        , patchesPerShard_{patchesPerShard}
+        , patchSize_{patchSize}
+        , type_{type}
+        , patchBytes_{static_cast<std::size_t>(patchSize.area()) * CV_ELEM_SIZE(type)}
+    {
+        if (patchesPerShard == 0) {
+            throw std::invalid_argument{"the number of patches per shard must be positive"};
+        }
+    }
+
+    void write(const PatchInfo& info, const cv::Mat& patch) override
+    {
+        if (patch.size() != patchSize_ || patch.type() != type_) {
+            throw std::invalid_argument{"all patches of a shard must have the same size and type"};
+        }
+
+        const std::size_t slot = info.index % patchesPerShard_;
+        Shard& shard = acquire(info.index / patchesPerShard_);
+
+        auto* out = static_cast<char*>(shard.region.get_address()) + sizeof(ShardHeader) + slot * patchBytes_;
+        const std::size_t rowBytes = static_cast<std::size_t>(patch.cols) * patch.elemSize();
+
+        for (int y = 0; y != patch.rows; ++y) {
+            std::memcpy(out + y * rowBytes, patch.ptr(y), rowBytes);
+        }
+
+        const cv::Matx23f& M = info.transform;
+        std::string row = std::format("{}\t{}\t{}\t{}\t{}\t{}\t{}\t{}\t{}\t{}\t{}\n", slot, info.index,
+                                      info.annotationFileName.string(), info.object.id, info.object.label,
+                                      M(0, 0), M(0, 1), M(0, 2), M(1, 0), M(1, 1), M(1, 2));
+
+        release(info.index / patchesPerShard_, slot, std::move(row));
+
+        bytesWritten_.fetch_add(patchBytes_, std::memory_order_relaxed);
+    }
+
+    void finish() override
+    {
+        std::scoped_lock lock{mutex_};
+
+        // Trailing shard with less than patchesPerShard patches
+        while (!shards_.empty()) {
+            close(shards_.begin());
+        }
+    }
+
+    [[nodiscard]] std::uintmax_t bytesWritten() const noexcept override
+    {
+        return bytesWritten_.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Shard
+    {
+        std::filesystem::path fileName;
+        boost::interprocess::mapped_region region;
+        // Metadata table rows indexed by the slot
+        std::vector<std::string> rows;
+        std::size_t numWritten = 0;
+    };
+
+    using ShardMap = std::map<std::size_t, std::unique_ptr<Shard> >;
+
+    Shard& acquire(std::size_t index)
+    {
+        namespace bip = boost::interprocess;
+
+        std::scoped_lock lock{mutex_};
+
+        auto pos = shards_.find(index);
+
+        if (pos == shards_.end()) {
+            auto shard = std::make_unique<Shard>();
+
+            boost::format fmt = fileNameFormat_;
+            shard->fileName = str(fmt % index);
+            shard->rows.resize(patchesPerShard_);
+
+            {
+                std::ofstream out{shard->fileName, std::ios_base::binary | std::ios_base::trunc};
+
+                if (!out) {
+                    throw std::runtime_error{"failed to create " + shard->fileName.string()};
+                }
+            }
+
+            std::filesystem::resize_file(shard->fileName, sizeof(ShardHeader) + patchesPerShard_ * patchBytes_);
+
+            const bip::file_mapping mapping{shard->fileName.c_str(), bip::read_write};
+            shard->region = bip::mapped_region{mapping, bip::read_write};
+
+            pos = shards_.emplace(index, std::move(shard)).first;
+        }
+
+        // The shard remains open at least until the slot is released
+        return *pos->second;
+    }
+
+    void release(std::size_t index, std::size_t slot, std::string row)
+    {
+        std::scoped_lock lock{mutex_};
+
+        const auto pos = shards_.find(index);
+        Shard& shard = *pos->second;
+
+        shard.rows[slot] = std::move(row);
+
+        if (++shard.numWritten == patchesPerShard_) {
+            close(pos);
+        }
+    }
+
+    // Writes the header and the metadata table of a shard that is not
+    // written to anymore.
+    void close(ShardMap::iterator pos)
+    {
+        Shard& shard = *pos->second;
+
+        // The trailing shard is filled only partially
+        std::size_t count = 0;
+
+        for (std::size_t i = 0; i != shard.rows.size(); ++i) {
+            if (!shard.rows[i].empty()) {
+                count = i + 1;
+            }
+        }
+
+        ShardHeader header{};
+        std::memcpy(header.magic, ShardHeader::Magic, sizeof header.magic);
+        header.version = ShardHeader::CurrentVersion;
+        header.headerSize = sizeof(ShardHeader);
+        header.width = static_cast<std::uint32_t>(patchSize_.width);
+        header.height = static_cast<std::uint32_t>(patchSize_.height);
+        header.channels = static_cast<std::uint32_t>(CV_MAT_CN(type_));
+        header.depth = static_cast<std::uint32_t>(CV_MAT_DEPTH(type_));
+        header.count = count;
+        header.patchSize = patchBytes_;
+        header.firstIndex = pos->first * patchesPerShard_;
+
+        std::memcpy(shard.region.get_address(), &header, sizeof header);
+
+        if (!shard.region.flush()) {
+            throw std::runtime_error{"failed to write " + shard.fileName.string()};
+        }
+
+        shard.region = boost::interprocess::mapped_region{};
+
+        if (count != patchesPerShard_) {
+            std::filesystem::resize_file(shard.fileName, sizeof(ShardHeader) + count * patchBytes_);
+        }
+
+        std::filesystem::path tableFileName = shard.fileName;
+        tableFileName.replace_extension(".tsv");
+
+        std::ofstream out{tableFileName};
+        out << "# slot\tindex\tannotation\tobject\tlabel\tm00\tm01\tm02\tm10\tm11\tm12\n";
+
+        for (std::size_t i = 0; i != count; ++i) {
+            out << shard.rows[i];
+        }
+
+        if (!out) {
+            throw std::runtime_error{"failed to write " + tableFileName.string()};
+        }
+
+        shards_.erase(pos);
+    }
+
+    boost::format fileNameFormat_;
+    std::size_t patchesPerShard_;
+    cv::Size patchSize_;
+    int type_;
+    std::size_t patchBytes_;
+    std::mutex mutex_;
+    ShardMap shards_;
+    std::atomic<std::uintmax_t> bytesWritten_{0};
+};
+
+} // namespace pav1iet
+
+#endif // PAV1IET_SHARD_WRITER_HPP
@@ -0,0 +1,250 @@
+//
+// pav1iet - PASCAL Annotation Version 1.00 Extractor Tool
+// Copyright (C) 2026 Sergiu Deitsch <sergiu.deitsch@gmail.com>
+//
+// This file is part of pav1iet.
+//
+// pav1iet is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pav1iet is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pav1iet.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#ifndef PAV1IET_TAR_ARCHIVE_HPP
+#define PAV1IET_TAR_ARCHIVE_HPP
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "file_buffer.hpp"
+
+namespace pav1iet {
+
+// Index of the regular files in a memory-mapped tar archive. Members are
+// handed out as slices of the mapping such that they can be parsed and
+// decoded without copying. Supports ustar archives including GNU long names,
+// base-256 sizes and pax extended headers. Compressed archives are not
+// supported.
+class TarArchive
+{
+public:
+    explicit TarArchive(const std::filesystem::path& fileName)
+        : fileName_{fileName}
+        , archive_{FileBuffer::map(fileName)}
+    {
+        index();
+    }
+
+    // Contents of the member with the given path. Paths are compared after
+    // lexical normalization. Throws std::runtime_error if the member does not
+    // exist.
+    [[nodiscard]] FileBuffer open(const std::filesystem::path& name) const
+    {
+        const auto pos = members_.find(normalize(name.generic_string()));
+
+        if (pos == members_.end()) {
+            throw std::runtime_error{"failed to open " + name.string() + ": no such member in " +
+                                     fileName_.string()};
+        }
+
+        return archive_.slice(pos->second.offset, pos->second.size);
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return members_.size();
+    }
+
+private:
+    static constexpr std::size_t BlockSize = 512;
+
+    struct Member
+    {
+        std::size_t offset;
+        std::size_t size;
+    };
+
+    void index()
+    {
+        const std::string_view archive = archive_.view();
+        // Overrides of the next header set by GNU long name and pax extended
+        // headers
+        std::optional<std::string> nextName;
+        std::optional<std::size_t> nextSize;
+
+        for (std::size_t offset = 0; offset + BlockSize <= archive.size();) {
+            const std::string_view header = archive.substr(offset, BlockSize);
+
+            if (std::ranges::all_of(header, [] (char c) { return c == '\0'; })) {
+                // End of archive
+                break;
+            }
+
+            if (!validChecksum(header)) {
+                throw std::runtime_error{"corrupt tar header in " + fileName_.string()};
+            }
+
+            const char type = header[156];
+            const std::size_t size = nextSize.value_or(parseNumber(header.substr(124, 12)));
+            const std::size_t data = offset + BlockSize;
+
+            if (size > archive.size() - data) {
+                throw std::runtime_error{"truncated tar archive " + fileName_.string()};
+            }
+
+            const std::string_view contents = archive.substr(data, size);
+            offset = data + (size + BlockSize - 1) / BlockSize * BlockSize;
+
+            if (type == 'L') {
+                nextName = std::string{field(contents)};
+                continue;
+            }
+
+            if (type == 'x') {
+                parsePaxHeader(contents, nextName, nextSize);
+                continue;
+            }
+
+            std::string name;
+
+            if (nextName) {
+                name = std::move(*nextName);
+            }
+            else {
+                const std::string_view prefix = field(header.substr(345, 155));
+                name = prefix.empty() || header.substr(257, 6) != std::string_view{"ustar", 6}
+                    ? std::string{field(header.substr(0, 100))}
+                    : std::string{prefix} + '/' + std::string{field(header.substr(0, 100))};
+            }
+
+            nextName.reset();
+            nextSize.reset();
+
+            if (type == '0' || type == '\0' || type == '7') {
+                // Later members replace earlier ones of the same name
+                members_.insert_or_assign(normalize(name), Member{data, size});
+            }
+            else if (type == '1') {
+                // Hard links refer to a previous member
+                const auto target = members_.find(normalize(std::string{field(header.substr(157, 100))}));
+
+                if (target != members_.end()) {
+                    members_.insert_or_assign(normalize(name), target->second);
+                }
+            }
+        }
+    }
+
+    [[nodiscard]] std::size_t parseNumber(std::string_view value) const
+    {
+        if (static_cast<unsigned char>(value.front()) & 0x80) {
+            // Base-256 encoding of large values
+            std::uintmax_t result = static_cast<unsigned char>(value.front()) & 0x7f;
+
+            for (const char c : value.substr(1)) {
+                result = result << 8 | static_cast<unsigned char>(c);
+            }
+
+            return static_cast<std::size_t>(result);
+        }
+
+        // Octal digits padded with spaces or zeros
+        const std::size_t first = value.find_first_not_of(' ');
+        const std::string_view digits = value.substr(std::min(first, value.size()));
+        std::size_t result = 0;
+        const auto error = std::from_chars(digits.data(), digits.data() + digits.size(), result, 8).ec;
+
+        if (error == std::errc::result_out_of_range) {
+            throw std::runtime_error{"corrupt tar header in " + fileName_.string()};
+        }
+
+        return result;
+    }
+
+    // Applies the path and size records of a pax extended header
+    void parsePaxHeader(std::string_view records, std::optional<std::string>& name,
+                        std::optional<std::size_t>& size) const
+    {
+        while (!records.empty()) {
+            // Each record is "<length> <key>=<value>\n" where the length
+            // includes the whole record
+            std::size_t length = 0;
+            const auto [end, error] = std::from_chars(records.data(), records.data() + records.size(), length);
+
+            // Number of digits of the length
+            const auto prefix = static_cast<std::size_t>(end - records.data());
+
+            if (error != std::errc{} || length > records.size() || prefix + 1 >= length || *end != ' ' ||
+                records[length - 1] != '\n') {
+                throw std::runtime_error{"corrupt pax header in " + fileName_.string()};
+            }
+
+            const std::string_view record = records.substr(prefix + 1, length - prefix - 2);
+            const std::size_t equal = record.find('=');
+
+            if (equal != std::string_view::npos) {
+                const std::string_view key = record.substr(0, equal);
+                const std::string_view value = record.substr(equal + 1);
+
+                if (key == "path") {
+                    name = std::string{value};
+                }
+                else if (key == "size") {
+                    std::size_t parsed = 0;
+                    std::from_chars(value.data(), value.data() + value.size(), parsed);
+                    size = parsed;
+                }
+            }
+
+            records.remove_prefix(length);
+        }
+    }
+
+    // Sum of the header bytes with the checksum field taken as spaces
+    [[nodiscard]] bool validChecksum(std::string_view header) const
+    {
+        unsigned sum = 0;
+
+        for (std::size_t i = 0; i != header.size(); ++i) {
+            sum += i >= 148 && i < 156 ? ' ' : static_cast<unsigned char>(header[i]);
+        }
+
+        return parseNumber(header.substr(148, 8)) == sum;
+    }
+
+    // Field up to the first NUL
+    [[nodiscard]] static std::string_view field(std::string_view value) noexcept
+    {
+        return value.substr(0, value.find('\0'));
+    }
+
+    [[nodiscard]] static std::string normalize(const std::string& name)
+    {
+        return std::filesystem::path{name}.lexically_normal().generic_string();
+    }
+
+    std::filesystem::path fileName_;
+    FileBuffer archive_;
+    std::unordered_map<std::string, Member> members_;
+};
+
+} // namespace pav1iet
+
+#endif // PAV1IET_TAR_ARCHIVE_HPP
@@ -0,0 +1,383 @@
+//
+// pav1iet - PASCAL Annotation Version 1.00 Extractor Tool
+// Copyright (C) 2026 Sergiu Deitsch <sergiu.deitsch@gmail.com>
+//
+// This file is part of pav1iet.
+//
+// pav1iet is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// pav1iet is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with pav1iet.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef PAV1IET_TRACE_HPP
+#define PAV1IET_TRACE_HPP
+
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <tbb/enumerable_thread_specific.h>
+
+namespace pav1iet {
+
+// CPU time consumed by the calling thread
+[[nodiscard]] inline std::chrono::nanoseconds threadCpuTime() noexcept
+{
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    timespec ts;
+
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+        return std::chrono::seconds{ts.tv_sec} + std::chrono::nanoseconds{ts.tv_nsec};
+    }
+#endif // CLOCK_THREAD_CPUTIME_ID
+
+    return std::chrono::nanoseconds::zero();
+}
+
+// Collects per-stage statistics of a pipeline and optionally records each
+// stage invocation as a trace event. Stages are identified by their index.
+// Items passed between the stages carry the time they were handed off by the
+// previous stage which allows to determine how long they waited for the next
+// stage.
+class PipelineTrace
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Measures a single stage invocation
+    class Span
+    {
+    public:
+        Span(PipelineTrace& trace, std::size_t stage, Clock::time_point handoff) noexcept
+            : trace_{trace}
+            , stage_{stage}
+            , handoff_{handoff}
+            , begin_{Clock::now()}
+            , cpuBegin_{threadCpuTime()}
+        {
+        }
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+        // Ends the invocation and returns the hand-off time for the next
+        // stage
+        Clock::time_point finish()
+        {
+            const Clock::time_point end = Clock::now();
+            trace_.record(stage_, handoff_, begin_, end, threadCpuTime() - cpuBegin_);
+            return end;
+        }
+
+    private:
+        PipelineTrace& trace_;
+        std::size_t stage_;
+        Clock::time_point handoff_;
+        Clock::time_point begin_;
+        std::chrono::nanoseconds cpuBegin_;
+    };
+
+    PipelineTrace(std::vector<std::string> stageNames, bool recordEvents)
+        : stageNames_{std::move(stageNames)}
+        , stages_(stageNames_.size())
+        , recordEvents_{recordEvents}
+        , start_{Clock::now()}
+        , lastTokenChange_{start_}
+    {
+    }
+
+    // Called when an item enters the pipeline
+    void admit()
+    {
+        changeTokens(+1);
+    }
+
+    // Called when an item leaves the pipeline
+    void release()
+    {
+        changeTokens(-1);
+    }
+
+    void read(std::uintmax_t bytes) noexcept
+    {
+        bytesRead_.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    // Time a pipeline thread spent blocked on reading a file
+    void ioWait(std::chrono::nanoseconds duration) noexcept
+    {
+        ioWait_.fetch_add(duration.count(), std::memory_order_relaxed);
+    }
+
+    // CPU time of tasks spawned by a stage invocation that ran on other
+    // threads than the invocation itself. The time is attributed to the
+    // stage since the span of the invocation covers only its own thread.
+    template<class Stage>
+    void nestedCpu(Stage id, std::chrono::nanoseconds duration) noexcept
+    {
+        stages_[static_cast<std::size_t>(id)].cpu.fetch_add(duration.count(), std::memory_order_relaxed);
+    }
+
+    // Prints the statistics of each stage
+    void summarize(std::ostream& out, std::uintmax_t bytesWritten) const
+    {
+        using Milliseconds = std::chrono::duration<double, std::milli>;
+
+        const double elapsed = std::chrono::duration<double>(Clock::now() - start_).count();
+
+        out << std::format("{:<16} {:>8} {:>12} {:>12} {:>12} {:>12}\n", "stage", "items", "wall/item",
+                           "cpu/item", "wait/item", "wall total");
+
+        for (std::size_t i = 0; i != stages_.size(); ++i) {
+            const Stage& stage = stages_[i];
+            const std::size_t count = stage.count.load(std::memory_order_relaxed);
+            const auto mean = [count] (const std::atomic<std::int64_t>& total) {
+                return Milliseconds{std::chrono::nanoseconds{total.load(std::memory_order_relaxed)}}.count() /
+                       static_cast<double>(std::max<std::size_t>(count, 1));
+            };
+
+            out << std::format("{:<16} {:>8} {:>10.3f}ms {:>10.3f}ms {:>10.3f}ms {:>11.1f}s\n", stageNames_[i],
+                               count, mean(stage.wall), mean(stage.cpu), mean(stage.wait),
+                               static_cast<double>(stage.wall.load(std::memory_order_relaxed)) * 1e-9);
+        }
+
+        {
+            std::scoped_lock lock{tokenMutex_};
+
+            const double area =
+                tokenArea_ + static_cast<double>(tokens_) * std::chrono::duration<double>(Clock::now() -
+                                                                                         lastTokenChange_).count();
+
+            out << std::format("tokens in flight: {:.1f} on average, {} at most\n",
+                               elapsed > 0 ? area / elapsed : 0.0, peakTokens_);
+        }
+
+        std::int64_t busy = 0;
+
+        for (const Stage& stage : stages_) {
+            busy += stage.wall.load(std::memory_order_relaxed);
+        }
+
+        const std::int64_t blocked = ioWait_.load(std::memory_order_relaxed);
+
+        out << std::format("blocked on reads: {:.1f}s of {:.1f}s stage time ({:.1f}%)\n",
+                           static_cast<double>(blocked) * 1e-9, static_cast<double>(busy) * 1e-9,
+                           busy > 0 ? 100.0 * static_cast<double>(blocked) / static_cast<double>(busy) : 0.0);
+
+        constexpr double MiB = 1024.0 * 1024.0;
+        const double read = static_cast<double>(bytesRead_.load(std::memory_order_relaxed)) / MiB;
+        const double written = static_cast<double>(bytesWritten) / MiB;
+
+        out << std::format("read {:.1f} MiB ({:.1f} MiB/s), wrote {:.1f} MiB ({:.1f} MiB/s) in {:.1f}s\n", read,
+                           elapsed > 0 ? read / elapsed : 0.0, written, elapsed > 0 ? written / elapsed : 0.0,
+                           elapsed);
+    }
+
+    // Writes the recorded events in the Chrome trace event format which can
+    // be loaded into Perfetto or chrome://tracing.
+    void writeEvents(const std::filesystem::path& fileName) const
+    {
+        std::ofstream out{fileName};
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+        const auto micros = [this] (Clock::time_point time) {
+            return std::chrono::duration<double, std::micro>(time - start_).count();
+        };
+
+        bool first = true;
+        const auto separate = [&out, &first] {
+            if (!first) {
+                out << ",\n";
+            }
+
+            first = false;
+        };
+
+        for (const ThreadEvents& thread : events_) {
+            separate();
+            out << std::format(R"({{"name":"thread_name","ph":"M","pid":1,"tid":{},"args":{{"name":"worker {}"}}}})",
+                               thread.id, thread.id);
+
+            for (const Event& e : thread.events) {
+                separate();
+
+                if (e.stage == TokenEvent) {
+                    out << std::format(R"({{"name":"tokens","ph":"C","pid":1,"tid":{},"ts":{:.3f},"args":{{"in flight":{}}}}})",
+                                       thread.id, micros(e.begin), e.value);
+                }
+                else {
+                    out << std::format(R"({{"name":"{}","ph":"X","pid":1,"tid":{},"ts":{:.3f},"dur":{:.3f},"args":{{"wait_us":{:.3f}}}}})",
+                                       stageNames_[e.stage], thread.id, micros(e.begin), micros(e.end) - micros(e.begin),
+                                       std::chrono::duration<double, std::micro>(std::chrono::nanoseconds{e.value}).count());
+                }
+            }
+        }
+
+        out << "\n]}\n";
+
+        if (!out) {
+            throw std::runtime_error{"failed to write " + fileName.string()};
+        }
+    }
+
+private:
+    static constexpr std::size_t TokenEvent = static_cast<std::size_t>(-1);
+
+    struct Stage
+    {
+        std::atomic_size_t count{0};
+        // Nanoseconds
+        std::atomic<std::int64_t> wall{0};
+        std::atomic<std::int64_t> cpu{0};
+        std::atomic<std::int64_t> wait{0};
+    };
+
+    struct Event
+    {
+        std::size_t stage;
+        Clock::time_point begin;
+        Clock::time_point end;
+        // Waiting time in nanoseconds or the number of tokens
+        std::int64_t value;
+    };
+
+    struct ThreadEvents
+    {
+        inline static std::atomic_size_t numThreads{0};
+
+        std::size_t id = numThreads.fetch_add(1, std::memory_order_relaxed);
+        std::vector<Event> events;
+    };
+
+    void record(std::size_t stage, Clock::time_point handoff, Clock::time_point begin, Clock::time_point end,
+                std::chrono::nanoseconds cpu)
+    {
+        Stage& s = stages_[stage];
+
+        // Items of the first stage are not handed off
+        const std::chrono::nanoseconds wait =
+            handoff == Clock::time_point{} ? std::chrono::nanoseconds::zero() : begin - handoff;
+
+        s.count.fetch_add(1, std::memory_order_relaxed);
+        s.wall.fetch_add((end - begin).count(), std::memory_order_relaxed);
+        s.cpu.fetch_add(cpu.count(), std::memory_order_relaxed);
+        s.wait.fetch_add(wait.count(), std::memory_order_relaxed);
+
+        if (recordEvents_) {
+            events_.local().events.push_back(Event{stage, begin, end, wait.count()});
+        }
+    }
+
+    void changeTokens(int delta)
+    {
+        const Clock::time_point now = Clock::now();
+        std::size_t tokens;
+
+        {
+            std::scoped_lock lock{tokenMutex_};
+
+            tokenArea_ += static_cast<double>(tokens_) * std::chrono::duration<double>(now - lastTokenChange_).count();
+            lastTokenChange_ = now;
+            tokens_ += delta;
+            peakTokens_ = std::max(peakTokens_, tokens_);
+            tokens = tokens_;
+        }
+
+        if (recordEvents_) {
+            events_.local().events.push_back(Event{TokenEvent, now, now, static_cast<std::int64_t>(tokens)});
+        }
+    }
+
+    std::vector<std::string> stageNames_;
+    std::vector<Stage> stages_;
+    bool recordEvents_;
+    Clock::time_point start_;
+    std::atomic<std::uintmax_t> bytesRead_{0};
+    std::atomic<std::int64_t> ioWait_{0};
+    mutable std::mutex tokenMutex_;
+    std::size_t tokens_ = 0;
+    std::size_t peakTokens_ = 0;
+    // Integral of the number of tokens over time in seconds
+    double tokenArea_ = 0;
+    Clock::time_point lastTokenChange_;
+    tbb::enumerable_thread_specific<ThreadEvents> events_;
+};
+
+// Wraps the body of the first pipeline stage which produces the items
+template<class Stage, class Body>
+[[nodiscard]] auto instrumentSource(PipelineTrace* trace, Stage id, Body body)
+{
+    const auto stage = static_cast<std::size_t>(id);
+
+    return [trace, stage, body = std::move(body)] <class FlowControl> (FlowControl& fc) {
+        if (trace == nullptr) {
+            return body(fc);
+        }
+
+        PipelineTrace::Span span{*trace, stage, PipelineTrace::Clock::time_point{}};
+
+        auto result = body(fc);
+        result.handoff = span.finish();
+
+        return result;
+    };
+}
+
+// Wraps a pipeline stage body to measure its invocations if tracing is
+// enabled. Items must provide a handoff member holding a
+// PipelineTrace::Clock::time_point. A body that does not return anything is
+// considered the last stage which releases the item. The overhead of a
+// disabled trace amounts to a single branch per invocation.
+template<class Stage, class Body>
+[[nodiscard]] auto instrument(PipelineTrace* trace, Stage id, Body body)
+{
+    const auto stage = static_cast<std::size_t>(id);
+
+    return [trace, stage, body = std::move(body)] <class Item> (Item item) {
+        if (trace == nullptr) {
+            return body(std::move(item));
+        }
+
+        PipelineTrace::Span span{*trace, stage, item.handoff};
+
+        if constexpr (std::is_void_v<decltype(body(std::move(item)))>) {
+            body(std::move(item));
+            span.finish();
+            // The item leaves the pipeline
+            trace->release();
+        }
+        else {
+            auto result = body(std::move(item));
+            result.handoff = span.finish();
+            return result;
+        }
+    };
+}
+
+} // namespace pav1iet
+
+#endif // PAV1IET_TRACE_HPP